@@ -0,0 +1,75 @@
+// Seal and Open throughput of NetworkManager::Cipher on one core
+// Build: g++ -std=c++20 -O2 -I<HelenaFramework> -I.. Cipher.cpp -o Cipher (add -DHELENA_CIPHER_NO_AVX2 for the generic path)
+// Usage: ./Cipher [payload bytes = 1400] [packets = 200000]
+
+#include <Helena/Engine/Engine.hpp>
+#include <NetworkManager.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using Cipher = Helena::Systems::NetworkManager::Cipher;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char** argv)
+{
+    const std::size_t size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1400;
+    const std::size_t packets = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200000;
+    constexpr int runs = 5;
+
+    Cipher::Key key{};
+    for(std::size_t index = 0; index < key.size(); ++index) {
+        key[index] = static_cast<std::uint8_t>(index);
+    }
+
+    // Nonce and associated data laid out as in NetworkManager: sequence in the nonce, channel as the only aad byte
+    std::uint8_t nonce[Cipher::NonceSize]{};
+    std::uint8_t channel = 0;
+    std::vector<std::uint8_t> data(size, 0x5A), sealed(packets * (size + Cipher::TagSize)), opened(size + Cipher::TagSize);
+
+    // Median of runs, every packet has its own nonce and buffer so nothing is served from a single cache line
+    double seal[runs], open[runs];
+    bool valid = true;
+    for(int run = 0; run < runs; ++run)
+    {
+        auto start = Clock::now();
+        for(std::uint64_t packet = 0; packet < packets; ++packet) {
+            std::memcpy(nonce + 4, &packet, sizeof(packet));
+            Cipher::Seal(key, nonce, &channel, sizeof(channel), data.data(), size, sealed.data() + packet * (size + Cipher::TagSize));
+        }
+
+        auto middle = Clock::now();
+        for(std::uint64_t packet = 0; packet < packets; ++packet) {
+            std::memcpy(nonce + 4, &packet, sizeof(packet));
+            valid &= Cipher::Open(key, nonce, &channel, sizeof(channel), sealed.data() + packet * (size + Cipher::TagSize), size + Cipher::TagSize, opened.data());
+        }
+
+        auto end = Clock::now();
+        seal[run] = std::chrono::duration<double>(middle - start).count();
+        open[run] = std::chrono::duration<double>(end - middle).count();
+    }
+
+    std::sort(seal, seal + runs);
+    std::sort(open, open + runs);
+
+    const double bytes = static_cast<double>(size) * packets;
+#if defined(__x86_64__) && !defined(HELENA_CIPHER_NO_AVX2) && (defined(__GNUC__) || defined(__clang__))
+    const char* path = __builtin_cpu_supports("avx2") ? "avx2" : "generic";
+#else
+    const char* path = "generic";
+#endif
+    std::printf("path=%s payload=%zu packets=%zu\n", path, size, packets);
+    std::printf("seal %8.1f MB/s %10.0f packets/s\n", bytes / seal[runs / 2] / 1e6, packets / seal[runs / 2]);
+    std::printf("open %8.1f MB/s %10.0f packets/s\n", bytes / open[runs / 2] / 1e6, packets / open[runs / 2]);
+
+    if(!valid) {
+        std::printf("open failed\n");
+        return 1;
+    }
+
+    return 0;
+}
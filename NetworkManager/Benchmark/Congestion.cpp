@@ -0,0 +1,104 @@
+// Bulk reliable transfer through an emulated link: goodput and queueing latency of ENet packet throttle against delay based congestion control
+// Build: g++ -std=c++20 -O2 -I.. Congestion.cpp -o Congestion
+// Usage: ./Congestion [throttle|delay] [loss = 0] [one way delay ms = 20] [bottleneck bytes/s = 2000000] [seconds = 6]
+
+#define ENET_IMPLEMENTATION
+#include "Relay.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+int main(int argc, char** argv)
+{
+    const bool delay = argc > 1 && std::string_view{argv[1]} == "delay";
+    Benchmark::Relay::Config config{};
+    config.m_Loss = argc > 2 ? std::atof(argv[2]) : 0.;
+    config.m_Delay = argc > 3 ? std::atoi(argv[3]) : 20;
+    config.m_Rate = argc > 4 ? std::atof(argv[4]) : 2e6;
+    config.m_QueueLimit = static_cast<std::size_t>(config.m_Rate / 10);    // 100 ms of buffer at the bottleneck
+    const int seconds = std::clamp(argc > 5 ? std::atoi(argv[5]) : 6, 1, 60);
+
+    constexpr std::uint16_t serverPort = 34710, relayPort = 34711;
+    enet_initialize();
+    Benchmark::Relay relay{relayPort, serverPort, config};
+
+    ENetAddress address{};
+    enet_address_set_ip(&address, "127.0.0.1");
+    address.port = serverPort;
+    ENetHost* server = enet_host_create(&address, 2, 1, 0, 0);
+    ENetHost* client = enet_host_create(nullptr, 1, 1, 0, 0);
+    if(!server || !client) {
+        std::printf("host create failed\n");
+        return 1;
+    }
+
+    if(delay) {
+        enet_host_set_congestion_control(server, enet_congestion_delay());
+        enet_host_set_congestion_control(client, enet_congestion_delay());
+    }
+
+    ENetPeer* peer = Benchmark::Connect(relay, server, client, relayPort);
+    if(!peer) {
+        std::printf("connect failed\n");
+        return 1;
+    }
+
+    // Sender keeps 256 messages of 1000 bytes queued, every message carries its send time
+    std::vector<std::uint8_t> message(1000, 1);
+    std::uint64_t received = 0, latencySum = 0, latencyCount = 0, latencyMax = 0;
+    std::vector<std::uint64_t> perSecond(seconds + 1);
+    const auto start = Benchmark::Clock::now(), end = start + std::chrono::seconds(seconds);
+    const auto elapsed = [&start] {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Benchmark::Clock::now() - start).count());
+    };
+
+    ENetEvent event;
+    while(Benchmark::Clock::now() < end)
+    {
+        while(enet_list_size(&peer->outgoingCommands) < 256) {
+            const std::uint64_t stamp = elapsed();
+            std::memcpy(message.data(), &stamp, sizeof(stamp));
+            enet_peer_send(peer, 0, enet_packet_create(message.data(), message.size(), ENET_PACKET_FLAG_RELIABLE));
+        }
+
+        relay.Pump();
+        while(enet_host_service(server, &event, 0) > 0) {}
+
+        relay.Pump();
+        while(enet_host_service(client, &event, 0) > 0)
+        {
+            if(event.type != ENET_EVENT_TYPE_RECEIVE) {
+                continue;
+            }
+
+            std::uint64_t stamp;
+            std::memcpy(&stamp, event.packet->data, sizeof(stamp));
+            const std::uint64_t now = elapsed(), latency = now - stamp;
+            latencySum += latency;
+            latencyMax = std::max(latencyMax, latency);
+            ++latencyCount;
+            received += event.packet->dataLength;
+            perSecond[std::min<std::uint64_t>(now / 1000000, seconds)] += event.packet->dataLength;
+            enet_packet_destroy(event.packet);
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    const double time = std::chrono::duration<double>(Benchmark::Clock::now() - start).count();
+    std::printf("congestion=%s loss=%.3f delay=%dms bottleneck=%.0fKB/s\n", delay ? "delay" : "throttle", config.m_Loss, config.m_Delay, config.m_Rate / 1e3);
+    std::printf("goodput=%.0fKB/s (%.0f%% of bottleneck) latency avg=%.0fms max=%.0fms lost=%llu rtt=%ums\n", received / time / 1e3, received / time * 100 / config.m_Rate,
+        latencyCount ? latencySum / 1e3 / latencyCount : 0., latencyMax / 1e3, static_cast<unsigned long long>(peer->totalPacketsLost), peer->roundTripTime);
+    std::printf("per second KB:");
+    for(int second = 0; second < seconds; ++second) {
+        std::printf(" %llu", static_cast<unsigned long long>(perSecond[second] / 1000));
+    }
+
+    std::printf("\n");
+    enet_host_destroy(client);
+    enet_host_destroy(server);
+    enet_deinitialize();
+    return 0;
+}
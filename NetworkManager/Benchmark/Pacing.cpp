@@ -0,0 +1,131 @@
+// Tick bursts through a shallow bottleneck queue: loss, burst size and latency of unreliable messages with and without pacing
+// Build: g++ -std=c++20 -O2 -I.. Pacing.cpp -o Pacing
+// Usage: ./Pacing [none|timer|txtime] [tick|thread] [messages per tick = 15] [queue bytes = 8000]
+// tick services the server once per 16 ms tick as Tick does, thread services it every millisecond as the I/O thread of threaded mode
+// txtime falls back to timer without SO_TXTIME support, without the fq qdisc on the loopback device the kernel sends at once
+
+#define ENET_IMPLEMENTATION
+#include "Relay.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+int main(int argc, char** argv)
+{
+    const std::string_view mode = argc > 1 ? argv[1] : "none";
+    const bool threaded = argc > 2 && std::string_view{argv[2]} == "thread";
+    const int perTick = argc > 3 ? std::atoi(argv[3]) : 15;
+    ENetPacing pacing = mode == "timer" ? ENET_PACING_TIMER : mode == "txtime" ? ENET_PACING_TXTIME : ENET_PACING_NONE;
+
+    Benchmark::Relay::Config config{};
+    config.m_Delay = 25;
+    config.m_Rate = 2e6;
+    config.m_QueueLimit = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 8000;
+    constexpr int seconds = 4;
+
+    constexpr std::uint16_t serverPort = 34720, relayPort = 34721;
+    enet_initialize();
+    Benchmark::Relay relay{relayPort, serverPort, config};
+
+    ENetAddress address{};
+    enet_address_set_ip(&address, "127.0.0.1");
+    address.port = serverPort;
+    ENetHost* server = enet_host_create(&address, 2, 1, 0, 0);
+    ENetHost* client = enet_host_create(nullptr, 1, 1, 0, 0);
+    if(!server || !client) {
+        std::printf("host create failed\n");
+        return 1;
+    }
+
+    if(pacing != ENET_PACING_NONE && enet_host_set_pacing(server, pacing) < 0) {
+        std::printf("txtime not available, timer pacing instead\n");
+        pacing = ENET_PACING_TIMER;
+        enet_host_set_pacing(server, pacing);
+    }
+
+    ENetPeer* peer = Benchmark::Connect(relay, server, client, relayPort);
+    if(!peer) {
+        std::printf("connect failed\n");
+        return 1;
+    }
+
+    // Round trip and rate estimates settle before measuring
+    ENetEvent event;
+    for(const auto settle = Benchmark::Clock::now(); Benchmark::Clock::now() - settle < std::chrono::milliseconds(1500);) {
+        relay.Pump();
+        while(enet_host_service(server, &event, 0) > 0) {}
+        relay.Pump();
+        while(enet_host_service(client, &event, 0) > 0) {}
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    relay.GetArrivals().clear();
+
+    // Game like sender, every 16 ms tick a batch of unreliable 1000 byte messages carrying their send time
+    std::vector<std::uint8_t> message(1000, 1);
+    std::uint64_t sent = 0, received = 0, latencySum = 0, latencyMax = 0;
+    const auto start = Benchmark::Clock::now(), end = start + std::chrono::seconds(seconds);
+    auto nextTick = start, nextService = start;
+    const auto elapsed = [&start] {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Benchmark::Clock::now() - start).count());
+    };
+
+    while(Benchmark::Clock::now() < end + std::chrono::milliseconds(300))
+    {
+        const auto now = Benchmark::Clock::now();
+        const bool tick = now >= nextTick && now < end;
+        if(tick) {
+            nextTick += std::chrono::milliseconds(16);
+            for(int index = 0; index < perTick; ++index, ++sent) {
+                const std::uint64_t stamp = elapsed();
+                std::memcpy(message.data(), &stamp, sizeof(stamp));
+                enet_peer_send(peer, 0, enet_packet_create(message.data(), message.size(), 0));
+            }
+        }
+
+        if(tick || (threaded && now >= nextService)) {
+            nextService = now + std::chrono::milliseconds(1);
+            while(enet_host_service(server, &event, 0) > 0) {}
+        }
+
+        relay.Pump();
+        while(enet_host_service(client, &event, 0) > 0)
+        {
+            if(event.type != ENET_EVENT_TYPE_RECEIVE) {
+                continue;
+            }
+
+            std::uint64_t stamp;
+            std::memcpy(&stamp, event.packet->data, sizeof(stamp));
+            const std::uint64_t latency = elapsed() - stamp;
+            latencySum += latency;
+            latencyMax = std::max(latencyMax, latency);
+            ++received;
+            enet_packet_destroy(event.packet);
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    // Burst size as the most datagrams reaching the bottleneck within one millisecond
+    std::vector<int> buckets(seconds * 1000 + 400);
+    for(const auto& arrival : relay.GetArrivals()) {
+        const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(arrival - start).count();
+        if(time >= 0 && time < static_cast<long long>(buckets.size())) {
+            ++buckets[time];
+        }
+    }
+
+    const char* names[] = {"none", "timer", "txtime"};
+    std::printf("pacing=%s service=%s messages/tick=%d queue=%zu\n", names[pacing], threaded ? "thread" : "tick", perTick, config.m_QueueLimit);
+    std::printf("sent=%llu received=%llu loss=%.1f%% peak datagrams/ms=%d latency avg=%.1fms max=%.1fms rate=%uKB/s\n",
+        static_cast<unsigned long long>(sent), static_cast<unsigned long long>(received), sent ? 100. * (sent - received) / sent : 0.,
+        *std::max_element(buckets.begin(), buckets.end()), received ? latencySum / 1e3 / received : 0., latencyMax / 1e3, peer->pacingRate / 1000);
+
+    enet_host_destroy(client);
+    enet_host_destroy(server);
+    enet_deinitialize();
+    return 0;
+}
@@ -0,0 +1,196 @@
+#ifndef HELENA_SYSTEMS_NETWORKMANAGER_BENCHMARK_RELAY_HPP
+#define HELENA_SYSTEMS_NETWORKMANAGER_BENCHMARK_RELAY_HPP
+
+// Loopback link emulator between an ENet client and server: random loss, one way delay and a bottleneck rate with a drop tail queue
+// POSIX sockets only, client connects to the front port and the relay forwards to the server port
+
+#include <enet/enet.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace Benchmark {
+
+    using Clock = std::chrono::steady_clock;
+
+    class Relay
+    {
+        struct Datagram {
+            Clock::time_point m_Release;
+            std::vector<char> m_Data;
+        };
+
+        // Index 0 is client to server, 1 is server to client
+        struct Direction {
+            std::deque<Datagram> m_Queue;   // Waits for the bottleneck
+            std::deque<Datagram> m_Delay;   // Serialized, waits for the one way delay
+            std::size_t m_QueueSize;
+            Clock::time_point m_Free;
+        };
+
+    public:
+        struct Config {
+            double m_Loss;              // Probability per datagram
+            int m_Delay;                // One way, milliseconds
+            double m_Rate;              // Bottleneck, bytes per second
+            std::size_t m_QueueLimit;   // Bytes waiting for the bottleneck, more are dropped
+        };
+
+        Relay(std::uint16_t port, std::uint16_t serverPort, const Config& config)
+            : m_Config{config}, m_Directions{}, m_Random{7}, m_Server{}, m_Client{}, m_HasClient{}
+        {
+            m_Front = socket(AF_INET, SOCK_DGRAM, 0);
+            m_Back = socket(AF_INET, SOCK_DGRAM, 0);
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(m_Front, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+
+            m_Server.sin_family = AF_INET;
+            m_Server.sin_port = htons(serverPort);
+            m_Server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            fcntl(m_Front, F_SETFL, O_NONBLOCK);
+            fcntl(m_Back, F_SETFL, O_NONBLOCK);
+            m_Directions[0].m_Free = m_Directions[1].m_Free = Clock::now();
+        }
+
+        ~Relay() {
+            close(m_Front);
+            close(m_Back);
+        }
+
+        Relay(const Relay&) = delete;
+        Relay& operator=(const Relay&) = delete;
+
+        // Receives from both sides, moves datagrams through the bottleneck and forwards those whose delay elapsed
+        void Pump()
+        {
+            char buffer[4096];
+            for(int direction = 0; direction < 2; ++direction)
+            {
+                for(;;)
+                {
+                    sockaddr_in from{};
+                    socklen_t length = sizeof(from);
+                    const auto received = recvfrom(direction == 0 ? m_Front : m_Back, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&from), &length);
+                    if(received <= 0) {
+                        break;
+                    }
+
+                    const auto size = static_cast<std::size_t>(received);
+
+                    if(direction == 0) {
+                        m_Client = from;
+                        m_HasClient = true;
+                    } else {
+                        m_Arrivals.push_back(Clock::now());
+                    }
+
+                    auto& link = m_Directions[direction];
+                    if(m_Uniform(m_Random) >= m_Config.m_Loss && link.m_QueueSize + size <= m_Config.m_QueueLimit) {
+                        link.m_Queue.push_back({{}, std::vector<char>(buffer, buffer + size)});
+                        link.m_QueueSize += size;
+                    }
+                }
+            }
+
+            const auto now = Clock::now();
+            for(int direction = 0; direction < 2; ++direction)
+            {
+                // Serialization at the bottleneck rate, an idle link does not build up credit beyond 200 us
+                auto& link = m_Directions[direction];
+                while(!link.m_Queue.empty())
+                {
+                    const auto start = std::max(link.m_Free, now - std::chrono::microseconds(200));
+                    if(start > now) {
+                        break;
+                    }
+
+                    auto& datagram = link.m_Queue.front();
+                    link.m_Free = start + std::chrono::nanoseconds(static_cast<long long>(datagram.m_Data.size() * 1e9 / m_Config.m_Rate));
+                    datagram.m_Release = link.m_Free + std::chrono::milliseconds(m_Config.m_Delay);
+                    link.m_QueueSize -= datagram.m_Data.size();
+                    link.m_Delay.push_back(std::move(datagram));
+                    link.m_Queue.pop_front();
+                }
+
+                while(!link.m_Delay.empty() && link.m_Delay.front().m_Release <= now)
+                {
+                    const auto& data = link.m_Delay.front().m_Data;
+                    if(direction == 0) {
+                        sendto(m_Back, data.data(), data.size(), 0, reinterpret_cast<const sockaddr*>(&m_Server), sizeof(m_Server));
+                    } else if(m_HasClient) {
+                        sendto(m_Front, data.data(), data.size(), 0, reinterpret_cast<const sockaddr*>(&m_Client), sizeof(m_Client));
+                    }
+
+                    link.m_Delay.pop_front();
+                }
+            }
+        }
+
+        // Times at which server datagrams reached the relay, before loss and queue
+        [[nodiscard]] std::vector<Clock::time_point>& GetArrivals() noexcept {
+            return m_Arrivals;
+        }
+
+    private:
+        Config m_Config;
+        Direction m_Directions[2];
+        std::mt19937 m_Random;
+        std::uniform_real_distribution<double> m_Uniform{0., 1.};
+        std::vector<Clock::time_point> m_Arrivals;
+        sockaddr_in m_Server;
+        sockaddr_in m_Client;
+        int m_Front;
+        int m_Back;
+        bool m_HasClient;
+    };
+
+    // Client connects to the server through the relay, returns the server side peer or nullptr after 5 seconds
+    inline ENetPeer* Connect(Relay& relay, ENetHost* server, ENetHost* client, std::uint16_t relayPort)
+    {
+        ENetAddress address{};
+        enet_address_set_ip(&address, "127.0.0.1");
+        address.port = relayPort;
+        enet_host_connect(client, &address, server->channelLimit, 0);
+
+        ENetPeer* peer = nullptr;
+        bool connected = false;
+        ENetEvent event;
+        const auto start = Clock::now();
+        while(!(connected && peer) && Clock::now() - start < std::chrono::seconds(5))
+        {
+            relay.Pump();
+            while(enet_host_service(server, &event, 0) > 0) {
+                if(event.type == ENET_EVENT_TYPE_CONNECT) {
+                    peer = event.peer;
+                }
+            }
+
+            while(enet_host_service(client, &event, 0) > 0) {
+                if(event.type == ENET_EVENT_TYPE_CONNECT) {
+                    connected = true;
+                }
+            }
+
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+
+        return connected ? peer : nullptr;
+    }
+}
+
+#endif // HELENA_SYSTEMS_NETWORKMANAGER_BENCHMARK_RELAY_HPP
@@ -0,0 +1,173 @@
+// Encode and decode cost of NetworkManager::Serializer against memcpy of the plain struct
+// Build: g++ -std=c++20 -O2 -I<HelenaFramework> -I.. Serializer.cpp -o Serializer
+// Usage: ./Serializer [messages = 4096] [passes = 2000]
+
+#include <Helena/Engine/Engine.hpp>
+#include <NetworkManager.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using NM = Helena::Systems::NetworkManager;
+using Clock = std::chrono::steady_clock;
+
+enum class EState : std::uint8_t { Idle, Walk, Run, Jump };
+
+// Fields as they are written, every member once and in full size
+struct Fields {
+    template <typename T>
+    using Schema = NM::Schema<NM::Field<&T::entity>, NM::Field<&T::x>, NM::Field<&T::y>, NM::Field<&T::z>, NM::Field<&T::yaw>,
+        NM::Field<&T::flags>, NM::Field<&T::state>, NM::Field<&T::grounded>, NM::Field<&T::health>, NM::Field<&T::tick>>;
+};
+
+// Small values in bit fields and varints
+struct Packed {
+    template <typename T>
+    using Schema = NM::Schema<NM::Field<&T::x>, NM::Field<&T::y>, NM::Field<&T::z>, NM::Field<&T::yaw>,
+        NM::BitField<&T::flags, 5>, NM::BitField<&T::state, 2>, NM::BitField<&T::grounded, 1>,
+        NM::Varint<&T::entity>, NM::Varint<&T::health>, NM::Varint<&T::tick>>;
+};
+
+// Typical movement update, memcpy sends it as it is in memory
+template <typename Format>
+struct Movement {
+    std::uint32_t entity;
+    float x, y, z;
+    std::uint16_t yaw;
+    std::uint8_t flags;
+    EState state;
+    bool grounded;
+    std::int32_t health;
+    std::uint64_t tick;
+
+    using Schema = typename Format::template Schema<Movement>;
+};
+
+struct Result {
+    double m_Encode;
+    double m_Decode;
+    double m_Size;
+};
+
+// Small entity ids, health and tick deltas as seen in game traffic, varints stay short
+template <typename T>
+static std::vector<T> Generate(std::size_t count)
+{
+    std::mt19937 random{7};
+    std::vector<T> messages(count);
+    for(auto& message : messages) {
+        message.entity = random() % 5000;
+        message.x = static_cast<float>(random() % 100000) / 10.f;
+        message.y = static_cast<float>(random() % 100000) / 10.f;
+        message.z = static_cast<float>(random() % 1000) / 10.f;
+        message.yaw = static_cast<std::uint16_t>(random());
+        message.flags = random() % 32;
+        message.state = static_cast<EState>(random() % 4);
+        message.grounded = random() % 2;
+        message.health = static_cast<std::int32_t>(random() % 200) - 100;
+        message.tick = 1000000 + random() % 100000;
+    }
+
+    return messages;
+}
+
+// Median ns per message over passes of the whole message array, bytes are average encoded size
+template <typename T, typename Encode, typename Decode>
+static Result Measure(std::size_t count, std::size_t passes, Encode&& encode, Decode&& decode)
+{
+    constexpr int runs = 5;
+    constexpr std::size_t stride = std::max<std::size_t>(sizeof(T), NM::Serializer<T>::MaxSize);
+
+    const std::vector<T> messages = Generate<T>(count);
+    std::vector<T> decoded(count);
+    std::vector<std::uint8_t> wire(count * stride);
+    std::vector<std::uint32_t> sizes(count);
+    double encodes[runs], decodes[runs];
+    bool valid = true;
+
+    for(int run = 0; run < runs; ++run)
+    {
+        auto start = Clock::now();
+        for(std::size_t pass = 0; pass < passes; ++pass) {
+            for(std::size_t index = 0; index < count; ++index) {
+                sizes[index] = encode(messages[index], wire.data() + index * stride);
+            }
+        }
+
+        auto middle = Clock::now();
+        for(std::size_t pass = 0; pass < passes; ++pass) {
+            for(std::size_t index = 0; index < count; ++index) {
+                valid &= decode(decoded[index], wire.data() + index * stride, sizes[index]);
+            }
+        }
+
+        auto end = Clock::now();
+        encodes[run] = std::chrono::duration<double, std::nano>(middle - start).count() / (passes * count);
+        decodes[run] = std::chrono::duration<double, std::nano>(end - middle).count() / (passes * count);
+    }
+
+    for(std::size_t index = 0; index < count; ++index) {
+        valid &= decoded[index].tick == messages[index].tick && decoded[index].health == messages[index].health && decoded[index].x == messages[index].x;
+    }
+
+    if(!valid) {
+        std::printf("decoded messages differ\n");
+        std::exit(1);
+    }
+
+    std::sort(encodes, encodes + runs);
+    std::sort(decodes, decodes + runs);
+
+    double size = 0;
+    for(auto value : sizes) {
+        size += value;
+    }
+
+    return {encodes[runs / 2], decodes[runs / 2], size / count};
+}
+
+int main(int argc, char** argv)
+{
+    const std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4096;
+    const std::size_t passes = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000;
+
+    using Plain = Movement<Fields>;
+    const auto plain = Measure<Plain>(count, passes,
+        [](const Plain& message, std::uint8_t* out) {
+            std::memcpy(out, &message, sizeof(message));
+            return static_cast<std::uint32_t>(sizeof(message));
+        },
+        [](Plain& message, const std::uint8_t* data, std::uint32_t size) {
+            std::memcpy(&message, data, size);
+            return true;
+        });
+
+    const auto fields = Measure<Plain>(count, passes,
+        [](const Plain& message, std::uint8_t* out) {
+            return NM::Serializer<Plain>::Write(message, out);
+        },
+        [](Plain& message, const std::uint8_t* data, std::uint32_t size) {
+            return NM::Serializer<Plain>::Read(message, data, size);
+        });
+
+    using Compact = Movement<Packed>;
+    const auto packed = Measure<Compact>(count, passes,
+        [](const Compact& message, std::uint8_t* out) {
+            return NM::Serializer<Compact>::Write(message, out);
+        },
+        [](Compact& message, const std::uint8_t* data, std::uint32_t size) {
+            return NM::Serializer<Compact>::Read(message, data, size);
+        });
+
+    std::printf("messages=%zu passes=%zu\n", count, passes);
+    std::printf("%-28s %8s %8s %8s\n", "", "encode", "decode", "bytes");
+    std::printf("%-28s %6.2fns %6.2fns %8.1f\n", "memcpy of struct", plain.m_Encode, plain.m_Decode, plain.m_Size);
+    std::printf("%-28s %6.2fns %6.2fns %8.1f\n", "Serializer, fields", fields.m_Encode, fields.m_Decode, fields.m_Size);
+    std::printf("%-28s %6.2fns %6.2fns %8.1f\n", "Serializer, bits and varints", packed.m_Encode, packed.m_Decode, packed.m_Size);
+    return 0;
+}
@@ -7,8 +7,35 @@
 #include <enet/enet.h>
 #include <string>
 #include <list>
+#include <deque>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <functional>
+#include <atomic>
+#include <cstddef>
 #include <memory>
+#include <random>
+#include <thread>
+#include <vector>
 #include <type_traits>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define HELENA_CIPHER_INLINE [[gnu::always_inline]] inline
+#else
+#define HELENA_CIPHER_INLINE inline
+#endif
+
+namespace Helena::Events::NetworkManager
+{
+    struct Message;
+}
 
 namespace Helena::Systems
 {
@@ -42,20 +69,137 @@ namespace Helena::Systems
             None,           // Not reliable and not sequenced
             Reliable,       // Reliable and sequenced packets
             Fragmented,     // Not reliable if packet size > MTU and sequenced
-            Unsequenced     // Not reliable and not sequenced
+            Unsequenced,    // Not reliable and not sequenced
+            Latest          // Not reliable and sequenced, queued message with the same key is replaced by newer one
+        };
+
+        enum class ECongestion : std::uint8_t
+        {
+            Throttle,       // ENet packet throttle by round trip time variance, unreliable packets are dropped under load
+            Delay           // Delivery rate and min round trip time estimate (BBR like), paced sending, loss does not shrink the window
+        };
+
+        enum class EPacing : std::uint8_t
+        {
+            None,           // Datagrams of a tick leave in one burst, only Delay congestion control paces
+            Timer,          // Datagrams are held until departure time and sent by the I/O thread loop, threaded mode only (TxTime otherwise)
+            TxTime          // Departure time is passed to the kernel (Linux SO_TXTIME with fq qdisc), spread inside the tick, fallback to Timer when threaded
         };
 
         class Network;
+        class Group;
         class UserData;
 
     private:
         struct Event {};
         struct Message {};
 
+    public:
+        // ChaCha20-Poly1305 AEAD (RFC 8439), keystream of 8 blocks per pass in vector registers when compiler supports it
+        // AVX2 is selected at runtime unless HELENA_CIPHER_NO_AVX2 is defined
+        class Cipher
+        {
+            static constexpr std::size_t BlockSize = 64;
+            static constexpr std::size_t Lanes = 8;
+
+            struct Poly1305 {
+                void Init(const std::uint8_t* key) noexcept;
+                void Update(const std::uint8_t* data, std::size_t size) noexcept;
+                void Pad() noexcept;    // Zero fill to 16 bytes boundary
+                void Finish(std::uint8_t* tag) noexcept;
+                void Blocks(const std::uint8_t* data, std::size_t size, std::uint32_t hibit) noexcept;
+
+                std::uint32_t m_R[5];
+                std::uint32_t m_H[5];
+                std::uint32_t m_Pad[4];
+                std::uint8_t m_Buffer[16];
+                std::size_t m_Leftover;
+            };
+
+        public:
+            static constexpr std::size_t KeySize = 32;
+            static constexpr std::size_t NonceSize = 12;
+            static constexpr std::size_t TagSize = 16;
+            static constexpr std::size_t WindowSize = 1024;    // Replay window in packets
+            static constexpr std::uint64_t Ordered = std::uint64_t{1} << 63;    // Sequence of reliable packet, per channel and not windowed
+
+            using Key = std::array<std::uint8_t, KeySize>;
+
+            // Keys and sequences of one connection
+            struct State {
+                Key m_SendKey;
+                Key m_ReceiveKey;
+                std::uint64_t m_SendSequence;
+                std::uint64_t m_ReceiveSequence;    // Highest accepted sequence
+                std::array<std::uint64_t, WindowSize / 64> m_Window;
+                std::array<std::uint8_t, 32> m_Salt;    // Server nonce, client nonce
+                std::vector<std::uint64_t> m_SendOrdered;       // Per channel, ENet delivers reliable packets in order
+                std::vector<std::uint64_t> m_ReceiveOrdered;    // Per channel, highest accepted reliable sequence
+            };
+
+            Cipher() = delete;
+            ~Cipher() = delete;
+            Cipher(const Cipher&) = delete;
+            Cipher(Cipher&&) noexcept = delete;
+            Cipher& operator=(const Cipher&) = delete;
+            Cipher& operator=(Cipher&&) noexcept = delete;
+
+            // Out receives size bytes of cipher text and the tag
+            static void Seal(const Key& key, const std::uint8_t* nonce, const std::uint8_t* aad, std::size_t aadSize,
+                const std::uint8_t* data, std::size_t size, std::uint8_t* out) noexcept;
+
+            // Size includes the tag, out may start before data. False when the tag does not match
+            [[nodiscard]] static bool Open(const Key& key, const std::uint8_t* nonce, const std::uint8_t* aad, std::size_t aadSize,
+                const std::uint8_t* data, std::size_t size, std::uint8_t* out) noexcept;
+
+            // HChaCha20 of 16 bytes input
+            [[nodiscard]] static Key Derive(const Key& key, const std::uint8_t* input) noexcept;
+
+            // Key identifier compared by handshake, key itself cannot be recovered from it
+            [[nodiscard]] static std::uint32_t GetKeyID(const Key& key) noexcept;
+
+            // Check before Open, Accept after it
+            [[nodiscard]] static bool Check(const State& state, std::uint64_t sequence) noexcept;
+            static void Accept(State& state, std::uint64_t sequence) noexcept;
+
+            static void Random(std::uint8_t* data, std::size_t size);
+
+        private:
+            static void Setup(std::uint32_t* state, const Key& key, const std::uint8_t* nonce, std::uint32_t counter) noexcept;
+            static void Block(const std::uint32_t* state, std::uint8_t* out) noexcept;
+            static void Xor(std::uint32_t* state, const std::uint8_t* data, std::size_t size, std::uint8_t* out) noexcept;
+            static void Authenticate(const std::uint8_t* key, const std::uint8_t* aad, std::size_t aadSize,
+                const std::uint8_t* data, std::size_t size, std::uint8_t* tag) noexcept;
+
+            template <typename T>
+            HELENA_CIPHER_INLINE static void Quarter(T& a, T& b, T& c, T& d) noexcept;
+
+            template <typename T>
+            HELENA_CIPHER_INLINE static void Rounds(T (&x)[16]) noexcept;
+
+#if defined(__GNUC__) || defined(__clang__)
+            using Vector = std::uint32_t __attribute__((vector_size(Lanes * sizeof(std::uint32_t))));
+
+            // Lanes blocks from state counter
+            static void Blocks(const std::uint32_t* state, std::uint8_t* out) noexcept;
+            HELENA_CIPHER_INLINE static void BlocksVector(const std::uint32_t* state, std::uint8_t* out) noexcept;
+            static void BlocksGeneric(const std::uint32_t* state, std::uint8_t* out) noexcept;
+#if defined(__x86_64__)
+            __attribute__((target("avx2"))) static void BlocksAvx2(const std::uint32_t* state, std::uint8_t* out) noexcept;
+#endif
+#endif
+
+            [[nodiscard]] static std::uint32_t Load32(const std::uint8_t* data) noexcept;
+            static void Store32(std::uint8_t* data, std::uint32_t value) noexcept;
+            static void Store64(std::uint8_t* data, std::uint64_t value) noexcept;
+        };
+
+    private:
         class Session
         {
         public:
-            Session() : m_UserData{}, m_HandshakeKey{}, m_State{}, m_Sequence{} {}
+            Session() : m_UserData{}, m_Coalesce{}, m_HandshakeKey{}, m_ConnectID{}, m_ConnectData{}, m_Index{}, m_CoalesceSize{}
+                , m_State{}, m_Sequence{}, m_Shard{}, m_CoalesceType{}, m_Capabilities{}, m_Cipher{} {}
             ~Session() = default;
             Session(const Session&) = delete;
             Session(Session&&) noexcept = default;
@@ -63,9 +207,288 @@ namespace Helena::Systems
             Session& operator=(Session&&) noexcept = default;
 
             std::unique_ptr<UserData> m_UserData;
+            ENetPacket* m_Coalesce;     // Aggregate of small unreliable messages, sent by next Service
             std::int64_t m_HandshakeKey;
+            std::uint32_t m_ConnectID;
+            std::uint32_t m_ConnectData;
+            std::uint32_t m_Index;      // Position in Network::m_Connections + 1, zero while not connected
+            std::uint32_t m_CoalesceSize;
             EStateConnection m_State;
             std::uint8_t m_Sequence;
+            std::uint8_t m_Shard;
+            EMessage m_CoalesceType;
+            std::uint8_t m_Capabilities;    // Negotiated by handshake
+            Cipher::State m_Cipher;         // Keys derived when connected with encryption
+        };
+
+        // Single producer single consumer ring, capacity rounded up to power of two
+        template <typename T>
+        requires std::is_trivially_copyable_v<T>
+        class RingSPSC
+        {
+        public:
+            explicit RingSPSC(std::size_t capacity) : m_Buffer(std::bit_ceil(capacity)), m_Mask{m_Buffer.size() - 1}, m_Head{}, m_Tail{}, m_Peak{} {}
+            ~RingSPSC() = default;
+            RingSPSC(const RingSPSC&) = delete;
+            RingSPSC(RingSPSC&&) noexcept = delete;
+            RingSPSC& operator=(const RingSPSC&) = delete;
+            RingSPSC& operator=(RingSPSC&&) noexcept = delete;
+
+            [[nodiscard]] bool Push(const T& value) noexcept;
+            [[nodiscard]] bool Pop(T& value) noexcept;
+
+            [[nodiscard]] std::size_t Size() const noexcept;
+            [[nodiscard]] std::size_t Peak() const noexcept;
+
+        private:
+            std::vector<T> m_Buffer;
+            std::size_t m_Mask;
+            alignas(64) std::atomic<std::size_t> m_Head;
+            alignas(64) std::atomic<std::size_t> m_Tail;
+            std::atomic<std::size_t> m_Peak;
+        };
+
+        // Bounded multi producer single consumer ring (Vyukov), capacity rounded up to power of two
+        template <typename T>
+        requires std::is_trivially_copyable_v<T>
+        class RingMPSC
+        {
+            struct Cell {
+                std::atomic<std::size_t> m_Sequence;
+                T m_Value;
+            };
+
+        public:
+            explicit RingMPSC(std::size_t capacity);
+            ~RingMPSC() = default;
+            RingMPSC(const RingMPSC&) = delete;
+            RingMPSC(RingMPSC&&) noexcept = delete;
+            RingMPSC& operator=(const RingMPSC&) = delete;
+            RingMPSC& operator=(RingMPSC&&) noexcept = delete;
+
+            [[nodiscard]] bool Push(const T& value) noexcept;
+            [[nodiscard]] bool Pop(T& value) noexcept;
+
+            [[nodiscard]] std::size_t Size() const noexcept;
+            [[nodiscard]] std::size_t Peak() const noexcept;
+
+        private:
+            std::unique_ptr<Cell[]> m_Buffer;
+            std::size_t m_Mask;
+            alignas(64) std::atomic<std::size_t> m_Head;
+            alignas(64) std::atomic<std::size_t> m_Tail;
+            std::atomic<std::size_t> m_Peak;
+        };
+
+        enum class ECommand : std::uint8_t {
+            Send,
+            SendShared,     // Packet holds one reference per posted command
+            Broadcast,
+            Connect,
+            Disconnect,
+            DisconnectLater,
+            DisconnectNow,
+            Reset
+        };
+
+        // ENet event passed from I/O thread to the tick
+        struct Inbound {
+            ENetEvent event;
+            std::int64_t time;
+            std::uint32_t connectID;
+        };
+
+        // ENet call passed from the tick to I/O thread
+        struct Outbound {
+            ENetAddress address;
+            ENetPeer* peer;
+            ENetPacket* packet;
+            std::uint32_t connectID;
+            std::uint32_t data;     // Replace key for Send
+            std::uint8_t channel;   // Channel count for Connect
+            ECommand type;
+        };
+
+        // I/O thread of threaded Network, owns the ENetHost while running
+        class Worker
+        {
+        public:
+            Worker(std::size_t capacity);
+            ~Worker();
+            Worker(const Worker&) = delete;
+            Worker(Worker&&) noexcept = delete;
+            Worker& operator=(const Worker&) = delete;
+            Worker& operator=(Worker&&) noexcept = delete;
+
+            void Start(ENetHost* host);
+            void Stop();
+
+            void Post(const Outbound& command);
+
+            // Clear m_Event after Poller reported it, must be called before m_Inbound is drained
+            void Acknowledge();
+
+            [[nodiscard]] static std::int64_t GetTime() noexcept;
+
+        private:
+            void Run(ENetHost* host);
+            [[nodiscard]] bool Execute(ENetHost* host, const Outbound& command, Inbound& inbound);
+            [[nodiscard]] bool Deliver(const Inbound& inbound);
+
+        public:
+            std::thread m_Thread;
+            RingSPSC<Inbound> m_Inbound;
+            RingMPSC<Outbound> m_Outbound;
+            std::atomic<bool> m_Running;
+
+            // eventfd signaled when m_Inbound gets data, -1 if not supported
+            int m_Event;
+            std::atomic<bool> m_Signaled;
+            bool m_Watched;
+
+            // Host counters published by I/O thread
+            std::atomic<std::uint32_t> m_SentPackets;
+            std::atomic<std::uint32_t> m_SendCalls;
+            std::atomic<std::uint32_t> m_ReplacedCommands;
+            std::atomic<std::uint32_t> m_ReceivedPackets;
+            std::atomic<std::uint32_t> m_ReceiveCalls;
+            std::atomic<std::uint32_t> m_CookieReplies;
+            std::atomic<std::uint32_t> m_CookieRejects;
+            std::atomic<std::uint64_t> m_CookieTime;
+            std::atomic<std::uint32_t> m_LimitedPackets;
+            std::atomic<std::uint64_t> m_LimitedBytes;
+            std::vector<std::atomic<std::uint32_t>> m_QueueDelay;
+
+            // Socket to handler latency, updated by the tick
+            std::uint64_t m_LatencyCount;
+            std::uint64_t m_LatencyTotal;
+            std::uint64_t m_LatencyMax;
+        };
+
+        // One ENetHost of Network, sharded servers share the port with SO_REUSEPORT
+        struct Shard {
+            ENetHost* m_Host;
+            std::unique_ptr<Worker> m_Worker;
+            bool m_Watched;     // Host socket registered in Poller
+        };
+
+        // Readiness of host sockets for Service, epoll on Linux and select elsewhere
+        class Poller
+        {
+        public:
+            static constexpr std::size_t EventsLimit = 64;
+
+            Poller();
+            ~Poller();
+            Poller(const Poller&) = delete;
+            Poller(Poller&&) noexcept = delete;
+            Poller& operator=(const Poller&) = delete;
+            Poller& operator=(Poller&&) noexcept = delete;
+
+            // Watch every socket before each Wait, select rebuilds its set while epoll keeps registration
+            void Watch(ENetSocket socket, bool& watched);
+            void Unwatch(ENetSocket socket, bool& watched);
+
+            void Wait(std::uint32_t timeout);
+            [[nodiscard]] bool Ready(ENetSocket socket) const noexcept;
+
+        private:
+        #ifdef __linux__
+            std::array<epoll_event, EventsLimit> m_Events;
+            std::size_t m_Count;
+            int m_Handle;
+        #else
+            ENetSocketSet m_Watch;
+            ENetSocketSet m_Ready;
+            ENetSocket m_MaxSocket;
+            bool m_Empty;
+        #endif
+        };
+
+        // Handshake timeouts indexed by peer id: O(1) add and remove, overdue peers are expired in bulk
+        class HandshakeWheel
+        {
+            static constexpr std::uint32_t None = 0xFFFFFFFF;
+
+            struct Node {
+                ENetPeer* m_Peer;
+                std::uint32_t m_Prev;
+                std::uint32_t m_Next;
+                std::uint32_t m_Expire;     // enet_time_get milliseconds
+            };
+
+        public:
+            static constexpr std::uint32_t SlotCount = 64;
+            static constexpr std::uint32_t SlotTime = 64;   // Milliseconds per slot, timeouts up to SlotCount * SlotTime
+
+            HandshakeWheel() : m_Nodes{}, m_Slots{}, m_Time{}, m_Pending{}, m_Expired{} {
+                m_Slots.fill(None);
+            }
+            ~HandshakeWheel() = default;
+            HandshakeWheel(const HandshakeWheel&) = delete;
+            HandshakeWheel(HandshakeWheel&&) noexcept = default;
+            HandshakeWheel& operator=(const HandshakeWheel&) = delete;
+            HandshakeWheel& operator=(HandshakeWheel&&) noexcept = default;
+
+            void Resize(std::size_t peers);
+            void Clear() noexcept;
+
+            void Add(std::uint32_t id, ENetPeer* peer, std::uint32_t expire);
+            void Remove(std::uint32_t id) noexcept;
+
+            // Unlink every peer with expire <= time and pass it to func
+            template <typename Func>
+            void Expire(std::uint32_t time, Func&& func);
+
+            [[nodiscard]] std::size_t Pending() const noexcept;
+            [[nodiscard]] std::uint64_t Expired() const noexcept;
+
+        private:
+            void Unlink(std::uint32_t id) noexcept;
+
+        private:
+            std::vector<Node> m_Nodes;
+            std::array<std::uint32_t, SlotCount> m_Slots;
+            std::uint32_t m_Time;
+            std::size_t m_Pending;
+            std::uint64_t m_Expired;
+        };
+
+        // LZ77 block compressor (LZ4 like sequences), shared dictionary is the history before each payload
+        class Compressor
+        {
+            static constexpr std::uint32_t None = 0xFFFFFFFF;
+            static constexpr std::uint32_t HashBits = 12;
+
+        public:
+            static constexpr std::uint32_t MinMatch = 4;
+            static constexpr std::uint32_t MaxInput = 0xFFFF;   // Offsets and positions are 16 bit
+
+            explicit Compressor(std::vector<std::uint8_t> dictionary);
+            ~Compressor() = default;
+            Compressor(const Compressor&) = delete;
+            Compressor(Compressor&&) noexcept = delete;
+            Compressor& operator=(const Compressor&) = delete;
+            Compressor& operator=(Compressor&&) noexcept = delete;
+
+            // Returns compressed size, zero when output does not fit capacity
+            [[nodiscard]] std::uint32_t Compress(const std::uint8_t* data, std::uint32_t size, std::uint8_t* out, std::uint32_t capacity) noexcept;
+
+            // False when data is malformed or does not decode to exactly size bytes
+            [[nodiscard]] bool Decompress(const std::uint8_t* data, std::uint32_t size, std::uint8_t* out, std::uint32_t outSize) const noexcept;
+
+            [[nodiscard]] std::uint32_t GetHash() const noexcept;
+
+        private:
+            [[nodiscard]] static std::uint32_t Read32(const std::uint8_t* data) noexcept;
+            [[nodiscard]] static std::uint32_t Hash(std::uint32_t value) noexcept;
+
+        private:
+            std::vector<std::uint8_t> m_Dictionary;
+            std::vector<std::uint32_t> m_DictionaryTable;   // Dictionary position by hash
+            std::vector<std::uint32_t> m_Table;             // Generation << 16 | input position by hash
+            std::uint32_t m_Hash;
+            std::uint16_t m_Generation;
         };
 
     public:
@@ -73,8 +496,8 @@ namespace Helena::Systems
         public:
             Config(std::string_view ip, std::uint16_t port, std::uint16_t peers, std::uint8_t channels, std::uint32_t data = 0,
                 std::uint32_t bandwidthIn = 0, std::uint32_t bandwidthOut = 0, std::uint32_t bufferSize = ENET_HOST_BUFFER_SIZE_MAX)
-                : m_IP{ip}, m_Port{port}, m_Peers{peers}, m_Channels{channels}, m_Data{data}
-                , m_BandwidthIn{bandwidthIn}, m_BandwidthOut{bandwidthOut}, m_BufferSize{bufferSize} {}
+                : m_IP{ip}, m_Dictionary{}, m_Schedule{}, m_Port{port}, m_Peers{peers}, m_Channels{channels}, m_Data{data}
+                , m_BandwidthIn{bandwidthIn}, m_BandwidthOut{bandwidthOut}, m_BufferSize{bufferSize}, m_ReceiveBatch{}, m_SendBatch{}, m_QueueSize{4096}, m_Budget{2000}, m_Compression{}, m_RateLimit{}, m_RateBurst{}, m_Coalesce{}, m_Shards{1}, m_Threaded{}, m_RetainPackets{}, m_Cookies{}, m_Checksum{}, m_EncryptionKey{}, m_Encryption{}, m_Congestion{}, m_Pacing{} {}
             ~Config() = default;
             Config(const Config&) = default;
             Config(Config&&) noexcept = default;
@@ -113,6 +536,100 @@ namespace Helena::Systems
                 m_BufferSize = size;
             }
 
+            // Datagrams received per syscall (recvmmsg on Linux), 0 or 1 disable batching
+            void SetReceiveBatch(std::uint8_t count) noexcept {
+                m_ReceiveBatch = count;
+            }
+
+            // Datagrams sent per syscall (sendmmsg on Linux) when host flush outgoing commands, 0 or 1 disable batching
+            void SetSendBatch(std::uint8_t count) noexcept {
+                m_SendBatch = count;
+            }
+
+            // Service host on own I/O thread, events are passed to the tick over lock-free rings
+            void SetThreaded(bool threaded) noexcept {
+                m_Threaded = threaded;
+            }
+
+            // Capacity of inbound and outbound rings in threaded mode
+            void SetQueueSize(std::uint32_t size) noexcept {
+                m_QueueSize = size;
+            }
+
+            // Server hosts bound to the same port (SO_REUSEPORT), peers are split between them
+            void SetShards(std::uint8_t shards) noexcept {
+                m_Shards = shards;
+            }
+
+            // Message event carry the Packet handle, handlers can keep it and release later
+            void SetRetainPackets(bool retain) noexcept {
+                m_RetainPackets = retain;
+            }
+
+            // Microseconds of event handling per network per update, rest is deferred to next update, 0 is unlimited
+            void SetBudget(std::uint32_t microseconds) noexcept {
+                m_Budget = microseconds;
+            }
+
+            // Pack None and Unsequenced messages into one packet up to size bytes per connection, flushed once per Service.
+            // Uses an extra internal channel, both sides must enable it, keep size below MTU. 0 disable coalescing
+            void SetCoalesce(std::uint16_t size) noexcept {
+                m_Coalesce = size;
+            }
+
+            // Compress payloads from size bytes when both sides enable it with the same dictionary, 0 disable compression
+            void SetCompression(std::uint32_t size) noexcept {
+                m_Compression = size;
+            }
+
+            // Shared pre-trained history for compression, must be equal on both sides
+            void SetDictionary(std::vector<std::uint8_t> dictionary) {
+                m_Dictionary = std::move(dictionary);
+            }
+
+            // Stateless cookie exchange before connect, server takes no peer until the client echoes a valid cookie.
+            // Both sides must enable it
+            void SetCookies(bool enable) noexcept {
+                m_Cookies = enable;
+            }
+
+            // CRC32C of every datagram, hardware crc32 instruction when available. Both sides must enable it
+            void SetChecksum(bool enable) noexcept {
+                m_Checksum = enable;
+            }
+
+            // Encrypt payloads with keys derived from this pre-shared key and handshake nonces, both sides must use the same key.
+            // Connections without encryption are rejected
+            void SetEncryption(const std::array<std::uint8_t, 32>& key) noexcept {
+                m_EncryptionKey = key;
+                m_Encryption = true;
+            }
+
+            // Priority and weight of the channel in outgoing queue of every connection. Higher priority is sent first,
+            // weight is the share of bandwidth between channels of one priority, unset channels are priority 0 with weight 1
+            void SetChannelSchedule(std::uint8_t channel, std::uint8_t priority, std::uint16_t weight = 1) {
+                if(m_Schedule.size() <= channel) {
+                    m_Schedule.resize(channel + 1u, ENetChannelSchedule{0, 1});
+                }
+                m_Schedule[channel] = ENetChannelSchedule{priority, weight};
+            }
+
+            // Congestion control of every connection on the send path, set on both sides to control both directions
+            void SetCongestion(ECongestion congestion) noexcept {
+                m_Congestion = congestion;
+            }
+
+            // Spread outgoing datagrams of every connection at the estimated path rate instead of one burst per tick, Timer needs SetThreaded
+            void SetPacing(EPacing pacing) noexcept {
+                m_Pacing = pacing;
+            }
+
+            // Datagrams per second and burst per source address, excess is dropped before parsing. 0 disable limiter, burst 0 is one second of rate
+            void SetRateLimit(std::uint32_t datagrams, std::uint32_t burst = 0) noexcept {
+                m_RateLimit = datagrams;
+                m_RateBurst = burst;
+            }
+
             [[nodiscard]] const std::string_view GetIP() const noexcept {
                 return m_IP;
             }
@@ -145,8 +662,86 @@ namespace Helena::Systems
                 return m_BufferSize;
             }
 
+            [[nodiscard]] std::uint8_t GetReceiveBatch() const noexcept {
+                return m_ReceiveBatch;
+            }
+
+            [[nodiscard]] std::uint8_t GetSendBatch() const noexcept {
+                return m_SendBatch;
+            }
+
+            [[nodiscard]] bool GetThreaded() const noexcept {
+                return m_Threaded;
+            }
+
+            [[nodiscard]] std::uint32_t GetQueueSize() const noexcept {
+                return m_QueueSize;
+            }
+
+            [[nodiscard]] std::uint8_t GetShards() const noexcept {
+                return m_Shards;
+            }
+
+            [[nodiscard]] std::uint32_t GetBudget() const noexcept {
+                return m_Budget;
+            }
+
+            [[nodiscard]] std::uint16_t GetCoalesce() const noexcept {
+                return m_Coalesce;
+            }
+
+            [[nodiscard]] std::uint32_t GetCompression() const noexcept {
+                return m_Compression;
+            }
+
+            [[nodiscard]] const std::vector<std::uint8_t>& GetDictionary() const noexcept {
+                return m_Dictionary;
+            }
+
+            [[nodiscard]] bool GetRetainPackets() const noexcept {
+                return m_RetainPackets;
+            }
+
+            [[nodiscard]] bool GetCookies() const noexcept {
+                return m_Cookies;
+            }
+
+            [[nodiscard]] bool GetChecksum() const noexcept {
+                return m_Checksum;
+            }
+
+            [[nodiscard]] const std::vector<ENetChannelSchedule>& GetChannelSchedule() const noexcept {
+                return m_Schedule;
+            }
+
+            [[nodiscard]] bool GetEncryption() const noexcept {
+                return m_Encryption;
+            }
+
+            [[nodiscard]] const std::array<std::uint8_t, 32>& GetEncryptionKey() const noexcept {
+                return m_EncryptionKey;
+            }
+
+            [[nodiscard]] ECongestion GetCongestion() const noexcept {
+                return m_Congestion;
+            }
+
+            [[nodiscard]] EPacing GetPacing() const noexcept {
+                return m_Pacing;
+            }
+
+            [[nodiscard]] std::uint32_t GetRateLimit() const noexcept {
+                return m_RateLimit;
+            }
+
+            [[nodiscard]] std::uint32_t GetRateBurst() const noexcept {
+                return m_RateBurst;
+            }
+
         private:
             std::string     m_IP;
+            std::vector<std::uint8_t> m_Dictionary;
+            std::vector<ENetChannelSchedule> m_Schedule;
             std::uint16_t   m_Port;
             std::uint16_t   m_Peers;
             std::uint8_t    m_Channels;
@@ -154,6 +749,68 @@ namespace Helena::Systems
             std::uint32_t   m_BandwidthIn;
             std::uint32_t   m_BandwidthOut;
             std::uint32_t   m_BufferSize;
+            std::uint8_t    m_ReceiveBatch;
+            std::uint8_t    m_SendBatch;
+            std::uint32_t   m_QueueSize;
+            std::uint32_t   m_Budget;
+            std::uint32_t   m_Compression;
+            std::uint32_t   m_RateLimit;
+            std::uint32_t   m_RateBurst;
+            std::uint16_t   m_Coalesce;
+            std::uint8_t    m_Shards;
+            bool            m_Threaded;
+            bool            m_RetainPackets;
+            bool            m_Cookies;
+            bool            m_Checksum;
+            std::array<std::uint8_t, 32> m_EncryptionKey;
+            bool            m_Encryption;
+            ECongestion     m_Congestion;
+            EPacing         m_Pacing;
+        };
+
+        struct Statistics {
+            std::uint32_t receivedPackets;  // Datagrams received by host
+            std::uint32_t receiveCalls;     // Receive syscalls, receivedPackets / receiveCalls is datagrams per syscall
+            std::uint32_t sentPackets;      // Datagrams sent by host
+            std::uint32_t sendCalls;        // Send syscalls
+            std::uint32_t sendCallsSaved;   // Syscalls saved by send batching
+            std::uint32_t replacedCommands; // Latest messages written over a queued one with the same key
+            std::size_t inboundDepth;       // Threaded mode: events waiting for the tick
+            std::size_t inboundPeak;
+            std::size_t outboundDepth;      // Threaded mode: commands waiting for I/O thread
+            std::size_t outboundPeak;
+            std::uint64_t latencyCount;     // Threaded mode: socket to handler latency in nanoseconds
+            std::uint64_t latencyTotal;
+            std::uint64_t latencyMax;
+            std::size_t handshakesPending;  // Server: connections waiting for handshake reply
+            std::uint64_t handshakesExpired; // Server: connections reset by handshake timeout
+            std::uint32_t eventsProcessed;  // Events handled by last update
+            std::uint32_t eventsDeferred;   // Events left to next update by time budget
+            std::uint32_t eventCost;        // Average nanoseconds per event, sizes batches inside the budget
+            std::uint64_t messagesCoalesced; // Messages packed into aggregates instead of own packets
+            std::uint64_t packetsCoalesced; // Aggregates sent, messagesCoalesced / packetsCoalesced is messages per packet
+            std::uint32_t cookieReplies;    // Server: cookies sent to connecting addresses
+            std::uint32_t connectsRejected; // Server: connects without a valid cookie, dropped before a peer is taken
+            std::uint32_t connectsRejectedRate; // Rejected connects per second, sampled once a second
+            std::uint64_t cookieTime;       // Nanoseconds spent answering and checking cookies
+            std::uint32_t datagramsLimited; // Datagrams dropped by rate limit before parsing
+            std::uint64_t bytesLimited;     // Bytes of dropped datagrams
+        };
+
+        // Per channel compression counters, raw and compressed bytes of compressed payloads only
+        struct CompressionStats {
+            std::uint64_t rawBytes;
+            std::uint64_t compressedBytes;
+            std::uint64_t packetsCompressed;
+            std::uint64_t packetsSkipped;   // Not smaller after compression or out of size limits
+            std::uint64_t compressTime;     // Nanoseconds
+            std::uint64_t decompressTime;
+        };
+
+        // Per channel histogram of time from send to datagram assembly, collected with Config::SetChannelSchedule
+        struct QueueDelayStats {
+            std::array<std::uint64_t, ENET_HOST_QUEUE_DELAY_BUCKETS> buckets;  // Bucket n counts delays below 2^n microseconds, last one is open
+            std::uint64_t count;
         };
 
         class UserData {
@@ -166,6 +823,118 @@ namespace Helena::Systems
             UserData& operator=(UserData&&) noexcept = default;
         };
 
+        // Thread local size-class pool used by ENet for all internal allocations
+        class Allocator
+        {
+            friend class NetworkManager;
+
+        public:
+            static constexpr std::size_t MinBlockSize = 32;
+            static constexpr std::size_t ClassCount = 8;    // 32, 64, 128 ... 4096 bytes
+            static constexpr std::uint32_t CacheLimit = 256;
+
+            struct Stats {
+                std::size_t size;
+                std::uint64_t hits;
+                std::uint64_t misses;
+            };
+
+        private:
+            struct alignas(alignof(std::max_align_t)) Header {
+                union {
+                    std::size_t m_Class;
+                    Header* m_Next;
+                };
+            };
+
+            // Hit/miss counts of one thread, written only by the owner and summed by GetStats.
+            // Blocks are never freed, a block released on thread exit is taken over by the next new thread
+            struct alignas(64) Counters {
+                std::array<std::atomic<std::uint64_t>, ClassCount> m_Hits;
+                std::array<std::atomic<std::uint64_t>, ClassCount> m_Misses;
+                std::atomic<bool> m_Used;
+                Counters* m_Next;
+            };
+
+            struct Cache {
+                Cache() noexcept;
+                ~Cache();
+                Cache(const Cache&) = delete;
+                Cache(Cache&&) noexcept = delete;
+                Cache& operator=(const Cache&) = delete;
+                Cache& operator=(Cache&&) noexcept = delete;
+
+                std::array<Header*, ClassCount> m_Head;
+                std::array<std::uint32_t, ClassCount> m_Count;
+                Counters* m_Counters;
+            };
+
+        public:
+            Allocator() = delete;
+            ~Allocator() = delete;
+            Allocator(const Allocator&) = delete;
+            Allocator(Allocator&&) noexcept = delete;
+            Allocator& operator=(const Allocator&) = delete;
+            Allocator& operator=(Allocator&&) noexcept = delete;
+
+            [[nodiscard]] static std::array<Stats, ClassCount> GetStats() noexcept;
+
+        private:
+            static void Install();
+
+            [[nodiscard]] static void* ENET_CALLBACK Malloc(std::size_t size);
+            static void ENET_CALLBACK Free(void* memory);
+
+            [[nodiscard]] static std::size_t GetClass(std::size_t size) noexcept;
+            [[nodiscard]] static Cache* GetCache() noexcept;
+            static void Count(std::atomic<std::uint64_t>& counter) noexcept;
+
+        private:
+            static inline std::atomic<Counters*> m_CounterList{};
+            static inline thread_local bool m_CacheDestroyed{};     // Trivially destructible, readable after the cache is gone
+        };
+
+        // Refcounted packet handle: outgoing packets are written straight into ENet memory,
+        // incoming packets can be kept by handlers when Config::SetRetainPackets is enabled
+        class Packet
+        {
+            friend class NetworkManager;
+
+            explicit Packet(ENetPacket* packet) noexcept;
+
+            [[nodiscard]] ENetPacket* Release(EMessage type) noexcept;
+            [[nodiscard]] static std::atomic_ref<std::uint32_t> GetCounter(ENetPacket* packet) noexcept;
+
+        public:
+            Packet() : m_Packet{}, m_Capacity{} {}
+            explicit Packet(std::uint32_t size);
+            ~Packet();
+            Packet(const Packet& other) noexcept;
+            Packet(Packet&& other) noexcept;
+            Packet& operator=(const Packet& other) noexcept;
+            Packet& operator=(Packet&& other) noexcept;
+
+            [[nodiscard]] std::uint8_t* GetData() noexcept;
+            [[nodiscard]] const std::uint8_t* GetData() const noexcept;
+
+            [[nodiscard]] std::uint32_t GetSize() const noexcept;
+            [[nodiscard]] std::uint32_t GetCapacity() const noexcept;
+
+            // Shrink packet after write, size must be less or equal than capacity
+            void Resize(std::uint32_t size) noexcept;
+
+            // Only unique packet can be sent, shared packets may be used from other threads
+            [[nodiscard]] bool Unique() const noexcept;
+            [[nodiscard]] bool Valid() const noexcept;
+
+        private:
+            void Reset() noexcept;
+
+        private:
+            ENetPacket* m_Packet;
+            std::uint32_t m_Capacity;
+        };
+
         class Connection 
         {
             friend class NetworkManager;
@@ -182,7 +951,9 @@ namespace Helena::Systems
             Connection& operator=(const Connection&) = default;
             Connection& operator=(Connection&&) noexcept = default;
 
-            void Send(EMessage type, std::uint8_t channel, const std::uint8_t* data, std::uint32_t size) const; 
+            // Key is used by EMessage::Latest only, zero key sends Latest as None
+            void Send(EMessage type, std::uint8_t channel, const std::uint8_t* data, std::uint32_t size, std::uint32_t key = 0) const; 
+            void Send(EMessage type, std::uint8_t channel, Packet packet, std::uint32_t key = 0) const;
 
             void Disconnect(EResetConnection flag, std::uint32_t data = 0);
 
@@ -211,10 +982,234 @@ namespace Helena::Systems
             std::uint8_t m_SequenceID;
         };
 
+        // Membership set of connections for multicast, one packet is shared by all members of a shard
+        class Group
+        {
+            friend class NetworkManager;
+
+            void Remove(ENetPeer* peer) noexcept;
+
+        public:
+            Group(Network* net, std::uint16_t id);
+            ~Group() = default;
+            Group(const Group&) = delete;
+            Group(Group&&) noexcept = default;
+            Group& operator=(const Group&) = delete;
+            Group& operator=(Group&&) noexcept = default;
+
+            // Only connected connections of the owner network can be added, dropped connections leave by itself
+            bool Add(const Connection& connection);
+            void Remove(const Connection& connection) noexcept;
+            void Clear() noexcept;
+
+            [[nodiscard]] bool Contains(const Connection& connection) const noexcept;
+            [[nodiscard]] std::size_t Size() const noexcept;
+            [[nodiscard]] std::uint16_t GetID() const noexcept;
+
+        private:
+            Network* m_Net;
+            std::vector<std::vector<ENetPeer*>> m_Members;  // Per shard, swap-remove
+            std::vector<std::uint32_t> m_Index;             // Position in shard members + 1 by connection id
+            std::size_t m_Size;
+            std::uint16_t m_GroupID;
+        };
+
+        // Schema field: member copied in little endian order, size is known at compile time
+        template <auto Member>
+        struct Field;
+
+        template <typename Class, typename Type, Type Class::* Member>
+        requires std::is_trivially_copyable_v<Type>
+        struct Field<Member> {
+            using Owner = Class;
+            using Value = Type;
+            static constexpr auto Pointer = Member;
+            static constexpr std::uint32_t FixedSize = sizeof(Type);
+            static constexpr std::uint32_t BitCount = 0;
+            static constexpr std::uint32_t VarintSize = 0;
+        };
+
+        // Schema field: integer as LEB128, signed values are zigzag encoded
+        template <auto Member>
+        struct Varint;
+
+        template <typename Class, typename Type, Type Class::* Member>
+        requires std::is_integral_v<Type>
+        struct Varint<Member> {
+            using Owner = Class;
+            using Value = Type;
+            static constexpr auto Pointer = Member;
+            static constexpr std::uint32_t FixedSize = 0;
+            static constexpr std::uint32_t BitCount = 0;
+            static constexpr std::uint32_t VarintSize = (sizeof(Type) * 8 + 6) / 7;
+        };
+
+        // Schema field: unsigned, bool or enum value in Bits bits, neighbour bit fields share bytes
+        template <auto Member, std::uint8_t Bits>
+        struct BitField;
+
+        template <typename Class, typename Type, Type Class::* Member, std::uint8_t Bits>
+        requires (std::is_unsigned_v<Type> || std::is_enum_v<Type>) && (Bits > 0 && Bits <= sizeof(Type) * 8)
+        struct BitField<Member, Bits> {
+            using Owner = Class;
+            using Value = Type;
+            static constexpr auto Pointer = Member;
+            static constexpr std::uint32_t FixedSize = 0;
+            static constexpr std::uint32_t BitCount = Bits;
+            static constexpr std::uint32_t VarintSize = 0;
+        };
+
+        // Field list of a message type: fixed fields, then bit fields, then varints
+        template <typename... Fields>
+        struct Schema {
+            static constexpr std::uint32_t BitCount = (Fields::BitCount + ... + 0);
+            static constexpr std::uint32_t FieldSize = (Fields::FixedSize + ... + 0);
+            static constexpr std::uint32_t FixedSize = FieldSize + (BitCount + 7) / 8;
+            static constexpr std::uint32_t MaxSize = FixedSize + (Fields::VarintSize + ... + 0);
+        };
+
+        // Encode and decode of T by T::Schema, straight into packet memory and in place from Message::data
+        template <typename T>
+        requires requires { typename T::Schema; }
+        class Serializer
+        {
+            using Layout = typename T::Schema;
+
+            struct Writer {
+                std::uint8_t* m_Fixed;
+                std::uint8_t* m_Bits;
+                std::uint8_t* m_Tail;
+                std::uint32_t m_BitOffset;
+            };
+
+            struct Reader {
+                const std::uint8_t* m_Fixed;
+                const std::uint8_t* m_Bits;
+                const std::uint8_t* m_Tail;
+                const std::uint8_t* m_End;
+                std::uint32_t m_BitOffset;
+            };
+
+            template <typename Field>
+            static void Write(const T& value, Writer& writer) noexcept;
+
+            template <typename Field>
+            [[nodiscard]] static bool Read(T& value, Reader& reader) noexcept;
+
+            template <typename Field>
+            [[nodiscard]] static std::uint32_t GetVarintSize(const T& value) noexcept;
+
+            template <typename Fields>
+            struct Apply;
+
+            template <typename... Fields>
+            struct Apply<Schema<Fields...>> {
+                static void Write(const T& value, Writer& writer) noexcept {
+                    (Serializer::Write<Fields>(value, writer), ...);
+                }
+
+                [[nodiscard]] static bool Read(T& value, Reader& reader) noexcept {
+                    return (Serializer::Read<Fields>(value, reader) && ...);
+                }
+
+                [[nodiscard]] static std::uint32_t GetVarintSize(const T& value) noexcept {
+                    return (Serializer::GetVarintSize<Fields>(value) + ... + 0);
+                }
+            };
+
+        public:
+            static constexpr std::uint32_t FixedSize = Layout::FixedSize;
+            static constexpr std::uint32_t MaxSize = Layout::MaxSize;
+
+            Serializer() = delete;
+            ~Serializer() = delete;
+            Serializer(const Serializer&) = delete;
+            Serializer(Serializer&&) noexcept = delete;
+            Serializer& operator=(const Serializer&) = delete;
+            Serializer& operator=(Serializer&&) noexcept = delete;
+
+            // Exact encoded size
+            [[nodiscard]] static std::uint32_t GetSize(const T& value) noexcept;
+
+            // Out must hold MaxSize or GetSize bytes, returns written size
+            static std::uint32_t Write(const T& value, std::uint8_t* out) noexcept;
+
+            // False when data is shorter than the encoded message
+            [[nodiscard]] static bool Read(T& value, const std::uint8_t* data, std::uint32_t size) noexcept;
+
+            // Packet with the router id prefix when T::ID is declared
+            [[nodiscard]] static Packet Encode(const T& value);
+        };
+
+        // Message handlers by id from the first bytes of a packet, routed messages are not signaled as events
+        class Router
+        {
+            friend class NetworkManager;
+
+            static constexpr std::uint32_t None = 0xFFFFFFFF;
+
+        public:
+            using Handler = std::function<void(const Events::NetworkManager::Message&)>;
+
+            static constexpr std::uint32_t HeaderSize = sizeof(std::uint16_t);    // Little endian id, Message data starts after it
+
+            struct Stats {
+                std::uint64_t count;    // Messages routed to the handler
+                std::uint64_t time;     // Nanoseconds spent in the handler
+            };
+
+        private:
+            struct Entry {
+                Handler m_Handler;
+                std::uint64_t m_Count;
+                std::uint64_t m_Time;
+            };
+
+            void Route(std::uint16_t id, const Events::NetworkManager::Message& message);
+
+        public:
+            Router() : m_Entries{}, m_Current{None}, m_Routes{} {}
+            ~Router() = default;
+            Router(const Router&) = delete;
+            Router(Router&&) noexcept = default;
+            Router& operator=(const Router&) = delete;
+            Router& operator=(Router&&) noexcept = default;
+
+            // Handler copied to each id of First..Last, range is checked at compile time and the table is grown once
+            template <std::uint16_t First, std::uint16_t Last = First>
+            requires (First <= Last)
+            void Register(Handler handler);
+
+            // Handler of T::ID called with the message decoded by Serializer
+            template <typename T, typename Func>
+            requires requires { T::ID; typename T::Schema; }
+            void Register(Func&& func);
+
+            // Handler cannot change its own route while it is called
+            void Register(std::uint16_t id, Handler handler);
+            void Unregister(std::uint16_t id);
+
+            [[nodiscard]] Stats GetStats(std::uint16_t id) const noexcept;
+            [[nodiscard]] bool Contains(std::uint16_t id) const noexcept;
+            [[nodiscard]] bool Empty() const noexcept;
+
+        private:
+            std::deque<Entry> m_Entries;    // Stable entries, a running handler may register other ids
+            std::uint32_t m_Current;
+            std::size_t m_Routes;
+        };
+
         class Network
         {
             friend class NetworkManager;
 
+            static constexpr std::uint32_t CoalesceHeader = 3;  // Channel and 16 bit size before each coalesced message
+            static constexpr std::uint32_t HandshakeNonceSize = 16;
+            static constexpr std::uint32_t HandshakeSize = sizeof(std::int64_t) + 1 + sizeof(std::uint32_t) * 2 + HandshakeNonceSize; // Key, capabilities, dictionary hash, key id, nonce
+            static constexpr std::uint32_t SequenceSize = sizeof(std::uint64_t);    // Explicit nonce before sealed payload
+            static constexpr std::uint8_t CapabilityCompression = 0x01;
+            static constexpr std::uint8_t CapabilityEncryption = 0x02;
+
         public:
             Network(std::uint16_t id);
             ~Network();
@@ -229,8 +1224,26 @@ namespace Helena::Systems
             void Shutdown();
 
             void Broadcast(EMessage type, std::uint8_t channel, const std::uint8_t* data, std::uint32_t size) const;
+            void Broadcast(EMessage type, std::uint8_t channel, Packet packet) const;
+
+            // Groups are removed by Shutdown
+            [[nodiscard]] Group& CreateGroup();
+            void RemoveGroup(std::uint16_t id) noexcept;
+
+            [[nodiscard]] Group* GetGroup(std::uint16_t id) noexcept;
+            [[nodiscard]] const Group* GetGroup(std::uint16_t id) const noexcept;
+
+            void SendGroup(const Group& group, EMessage type, std::uint8_t channel, const std::uint8_t* data, std::uint32_t size) const;
+            void SendGroup(const Group& group, EMessage type, std::uint8_t channel, Packet packet) const;
 
             [[nodiscard]] std::uint16_t GetID() const noexcept;
+            [[nodiscard]] Statistics GetStatistics() const noexcept;
+
+            [[nodiscard]] Router& GetRouter() noexcept;
+            [[nodiscard]] const Router& GetRouter() const noexcept;
+
+            [[nodiscard]] CompressionStats GetCompressionStats(std::uint8_t channel) const noexcept;
+            [[nodiscard]] QueueDelayStats GetQueueDelay(std::uint8_t channel) const noexcept;
 
             void SetUserData(std::unique_ptr<UserData> data);
 
@@ -253,21 +1266,84 @@ namespace Helena::Systems
 
         private:
             [[nodiscard]] static bool CreateAddress(ENetAddress& address, const std::string_view ip, std::uint16_t port);
-            [[nodiscard]] static ENetHost* CreateHost(const Config& config, bool isServer);
+            [[nodiscard]] static ENetHost* CreateHost(const Config& config, bool isServer, std::uint8_t shard = 0);
+            [[nodiscard]] static std::uint8_t GetChannelCount(const Config& config) noexcept;
             [[nodiscard]] static std::int64_t Scramble(std::int64_t nInput) noexcept;
-            [[nodiscard]] static bool SendHandshake(ENetPeer* peer, std::int64_t key);
-
-            void AddHandshake(ENetPeer* peer);
+            [[nodiscard]] bool SendHandshake(ENetPeer* peer, std::int64_t key) const;
+            [[nodiscard]] std::uint8_t Negotiate(const std::uint8_t* data) const noexcept;
+            [[nodiscard]] std::uint64_t GetHandshakeSalt(const ENetPeer* peer) const noexcept;
+            void SetupCipher(ENetPeer* peer) const;
+            [[nodiscard]] Worker* GetWorker(const ENetPeer* peer) const noexcept;
+
+            // ENet peer calls, posted to I/O thread in threaded mode
+            [[nodiscard]] bool PeerSend(ENetPeer* peer, std::uint8_t channel, ENetPacket* packet, std::uint32_t key = 0) const;
+            void PeerDisconnect(ENetPeer* peer, EResetConnection flag, std::uint32_t data) const;
+            void PeerReset(ENetPeer* peer) const;
+
+            void AddHandshake(ENetPeer* peer, std::uint32_t timeout);
             void RemoveHandshake(ENetPeer* peer);
 
-            void Update(std::uint32_t timeout = 0, std::uint32_t eventsLimit = 100);
+            void AddConnection(ENetPeer* peer);
+            void RemoveConnection(ENetPeer* peer);
+
+            // Append message to the peer aggregate, false if it must be sent as own packet
+            [[nodiscard]] bool Coalesce(ENetPeer* peer, EMessage type, std::uint8_t channel, const std::uint8_t* data, std::uint32_t size);
+            void FlushCoalesced();
+            void FlushCoalesced(ENetPeer* peer);
+            void DropCoalesced(ENetPeer* peer);
+
+            // Payload of a session with negotiated compression starts with a frame mode byte
+            [[nodiscard]] ENetPacket* Frame(std::uint8_t channel, const ENetPacket* packet) const;
+            [[nodiscard]] ENetPacket* Frame(ENetPeer* peer, std::uint8_t channel, ENetPacket* packet) const;
+            [[nodiscard]] ENetPacket* Unframe(ENetPeer* peer, std::uint8_t channel, ENetPacket* packet);
+
+            // Sealed payload is the 64 bit sequence, cipher text and tag, channel is authenticated with it.
+            // Reliable packets are sequenced per channel and must only grow, others are checked by the replay window
+            [[nodiscard]] ENetPacket* Seal(ENetPeer* peer, std::uint8_t channel, const ENetPacket* packet) const;
+            [[nodiscard]] ENetPacket* Open(ENetPeer* peer, std::uint8_t channel, ENetPacket* packet);
+
+            // Packet is held by caller, peers are indexed by shard, Multicast sends framed copy to peers with compression
+            // and own sealed copy to every peer with encryption
+            void Multicast(std::uint8_t channel, ENetPacket* packet, const std::vector<std::vector<ENetPeer*>>& peers) const;
+            void SendShards(std::uint8_t channel, ENetPacket* packet, const std::vector<std::vector<ENetPeer*>>& peers) const;
+
+            void Update(Shard& shard, std::int64_t deadline);
+            void UpdateHandshakes();
+            void UpdateCookies();
+            void Dispatch(ENetEvent& event, std::uint32_t connectID);
+            void DispatchCoalesced(const Connection& conn, ENetPacket* aggregate, EMessage type);
+            void Publish(const Connection& conn, std::uint8_t* data, std::uint32_t size, EMessage type, std::uint8_t channel, Packet packet = {});
 
         private:
-            ENetHost* m_Host;
-            std::list<Connection> m_HandshakeList;
+            std::vector<Shard> m_Shards;
+            std::vector<ENetPeer*> m_Connections;   // Connected peers of all shards, swap-remove on disconnect
+            std::vector<ENetPeer*> m_Coalesced;     // Peers with an aggregate waiting for flush
+            std::list<Group> m_Groups;
+            Router m_Router;
+            std::unique_ptr<Compressor> m_Compressor;
+            mutable std::vector<CompressionStats> m_CompressionStats;  // Updated by const Broadcast
+            HandshakeWheel m_Handshakes;
             std::unique_ptr<UserData> m_UserData;
+            Cipher::Key m_CipherKey;                // Pre-shared key
+            std::uint32_t m_CipherKeyID;            // Compared in handshake, derived from the key
             std::uint16_t m_NetworkID;
+            std::uint16_t m_GroupSequenceID;
+            std::uint32_t m_Budget;
+            std::uint32_t m_EventCost;
+            std::uint32_t m_EventsProcessed;
+            std::uint32_t m_EventsDeferred;
+            std::uint64_t m_MessagesCoalesced;
+            std::uint64_t m_PacketsCoalesced;
+            std::int64_t m_CookieSampleTime;
+            std::uint32_t m_CookieSampleRejects;
+            std::uint32_t m_CookieRejectRate;
+            std::uint32_t m_Compression;
+            std::uint16_t m_Coalesce;
+            std::uint8_t m_CoalesceChannel;         // Internal channel after user channels
             bool m_Server;
+            bool m_RetainPackets;
+            bool m_Cookies;
+            bool m_Encryption;
             bool m_Initialized;
         };
 
@@ -287,6 +1363,9 @@ namespace Helena::Systems
 
         [[nodiscard]] std::size_t Count() const noexcept;
 
+        // Service networks with pending datagrams or due ENet timers, sleep up to timeout ms while nothing is ready
+        void Service(std::uint32_t timeout);
+
         // Iterators
         [[nodiscard]] auto begin() noexcept;
         [[nodiscard]] auto begin() const noexcept;
@@ -295,10 +1374,10 @@ namespace Helena::Systems
         
     private:
         void Tick(const Helena::Events::Engine::Tick ev);
-        static void Service(Network& net, std::uint32_t timeout);
 
     private:
         std::list<Network> m_Networks;
+        Poller m_Poller;
         std::uint16_t m_NetworkSequenceID;
         bool m_Initialized;
     };
@@ -318,6 +1397,7 @@ namespace Helena::Events::NetworkManager
         std::uint32_t size;
         Systems::NetworkManager::EMessage type;
         std::uint8_t channel;
+        Systems::NetworkManager::Packet packet;     // Valid only when Config::SetRetainPackets is enabled, whole aggregate for coalesced messages
     };
 }
 
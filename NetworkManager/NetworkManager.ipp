@@ -4,528 +4,3418 @@
 #include "NetworkManager.hpp"
 #include <Helena/Engine/Engine.hpp>
 
+#include <algorithm>
+#include <bit>
 #include <chrono>
+#include <cstdlib>
+#include <limits>
+#include <new>
 
 namespace Helena::Systems
 {
-    /* ------------ [NetworkManager::Connection] ------------ */
-    [[nodiscard]] inline std::uint8_t NetworkManager::Connection::GetSequenceID() noexcept {
-        return static_cast<Session*>(m_Peer->data)->m_Sequence;
+    /* ------------- [NetworkManager::Allocator] ------------ */
+    inline NetworkManager::Allocator::Cache::Cache() noexcept : m_Head{}, m_Count{}, m_Counters{}
+    {
+        // Take over counters of an exited thread, totals keep its counts
+        for(auto counters = m_CounterList.load(std::memory_order_acquire); counters; counters = counters->m_Next) {
+            if(!counters->m_Used.load(std::memory_order_relaxed) && !counters->m_Used.exchange(true, std::memory_order_acquire)) {
+                m_Counters = counters;
+                return;
+            }
+        }
+
+        m_Counters = new (std::nothrow) Counters{};
+        if(m_Counters) {
+            m_Counters->m_Used.store(true, std::memory_order_relaxed);
+            m_Counters->m_Next = m_CounterList.load(std::memory_order_relaxed);
+            while(!m_CounterList.compare_exchange_weak(m_Counters->m_Next, m_Counters, std::memory_order_release, std::memory_order_relaxed)) {}
+        }
     }
 
-    [[nodiscard]] inline bool NetworkManager::Connection::Validate() const noexcept {
-        return m_Peer && m_Peer->data && m_SequenceID == static_cast<const Session*>(m_Peer->data)->m_Sequence;
+    inline NetworkManager::Allocator::Cache::~Cache()
+    {
+        for(auto& head : m_Head) {
+            while(head) {
+                const auto next = head->m_Next;
+                std::free(head);
+                head = next;
+            }
+        }
+
+        if(m_Counters) {
+            m_Counters->m_Used.store(false, std::memory_order_release);
+        }
+
+        m_Count = {};
+        m_CacheDestroyed = true;
     }
 
-    inline void NetworkManager::Connection::Send(EMessage type, std::uint8_t channel, const std::uint8_t* data, std::uint32_t size) const
+    [[nodiscard]] inline std::array<NetworkManager::Allocator::Stats, NetworkManager::Allocator::ClassCount> NetworkManager::Allocator::GetStats() noexcept
     {
-        if(Valid())
-        {
-            const auto session = static_cast<Session*>(m_Peer->data);
-            if(session->m_State != EStateConnection::Connected) {
-                HELENA_MSG_WARNING("Packet cannot be sent now for connection!");
-                return;
+        std::array<Stats, ClassCount> stats{};
+        for(std::size_t i = 0; i < ClassCount; ++i) {
+            stats[i].size = MinBlockSize << i;
+        }
+
+        for(auto counters = m_CounterList.load(std::memory_order_acquire); counters; counters = counters->m_Next) {
+            for(std::size_t i = 0; i < ClassCount; ++i) {
+                stats[i].hits   += counters->m_Hits[i].load(std::memory_order_relaxed);
+                stats[i].misses += counters->m_Misses[i].load(std::memory_order_relaxed);
+            }
+        }
+
+        return stats;
+    }
+
+    inline void NetworkManager::Allocator::Install()
+    {
+        // ENet callbacks are global, set them once before any host exists (I/O threads read them)
+        [[maybe_unused]] static const bool installed = [] {
+            const ENetCallbacks callbacks{&Malloc, &Free, nullptr};
+            if(enet_initialize_with_callbacks(ENET_VERSION, &callbacks)) {
+                return false;
             }
 
-            if(void* memory = enet_malloc(sizeof(ENetPacket) + size))
+            enet_deinitialize();
+            return true;
+        }();
+    }
+
+    [[nodiscard]] inline void* ENET_CALLBACK NetworkManager::Allocator::Malloc(std::size_t size)
+    {
+        const auto index = GetClass(size);
+        if(index < ClassCount)
+        {
+            // No cache and no counts once the thread is tearing down
+            if(const auto cache = GetCache())
             {
-                const auto packet = static_cast<ENetPacket*>(memory);
+                if(const auto header = cache->m_Head[index]) {
+                    cache->m_Head[index] = header->m_Next;
+                    cache->m_Count[index]--;
+                    header->m_Class = index;
+                    if(cache->m_Counters) {
+                        Count(cache->m_Counters->m_Hits[index]);
+                    }
+                    return header + 1;
+                }
 
-                switch(type)
-                {
-                    case EMessage::None:        packet->flags = 0; break;
-                    case EMessage::Reliable:    packet->flags = ENetPacketFlag::ENET_PACKET_FLAG_RELIABLE; break;
-                    case EMessage::Fragmented:  packet->flags = ENetPacketFlag::ENET_PACKET_FLAG_UNRELIABLE_FRAGMENTED; break;
-                    case EMessage::Unsequenced: packet->flags = ENetPacketFlag::ENET_PACKET_FLAG_UNSEQUENCED; break;
+                if(cache->m_Counters) {
+                    Count(cache->m_Counters->m_Misses[index]);
                 }
+            }
 
-                packet->data = static_cast<std::uint8_t*>(memory) + sizeof(ENetPacket);
-                packet->referenceCount = 0;
-                packet->dataLength = size;
-                packet->freeCallback = nullptr;
-                packet->userData = nullptr;
+            size = MinBlockSize << index;
+        }
 
-                std::memcpy(packet->data, data, size);
-                enet_peer_send(m_Peer, channel, packet);
-            }
+        const auto header = static_cast<Header*>(std::malloc(sizeof(Header) + size));
+        if(!header) {
+            return nullptr;
         }
+
+        header->m_Class = index;
+        return header + 1;
     }
 
-    inline void NetworkManager::Connection::Disconnect(EResetConnection flag, std::uint32_t data)
+    inline void ENET_CALLBACK NetworkManager::Allocator::Free(void* memory)
     {
-        if(!Valid()) {
+        if(!memory) {
             return;
         }
 
-        const auto session = static_cast<Session*>(m_Peer->data);
-        if(session->m_State != EStateConnection::Disconnecting && session->m_State != EStateConnection::Disconnected)
+        const auto header = static_cast<Header*>(memory) - 1;
+        const auto index = header->m_Class;
+        if(index < ClassCount)
         {
-            switch(flag)
-            {
-                case EResetConnection::Default: {
-                    session->m_State = EStateConnection::Disconnecting;
-                    enet_peer_disconnect_later(m_Peer, data);
-                } break;
-                case EResetConnection::Update: {
-                    session->m_State = EStateConnection::Disconnecting;
-                    enet_peer_disconnect(m_Peer, data);
-                } break;
-                case EResetConnection::Force: {
-                    session->m_State = EStateConnection::Disconnected;
-                    enet_peer_reset(m_Peer);
-                } break;
-                case EResetConnection::Now: {
-                    session->m_State = EStateConnection::Disconnecting;
-                    enet_peer_disconnect_now(m_Peer, data);
-                } break;
+            // Blocks are malloc'ed one by one, so any thread may keep them
+            if(const auto cache = GetCache(); cache && cache->m_Count[index] < CacheLimit) {
+                header->m_Next = cache->m_Head[index];
+                cache->m_Head[index] = header;
+                cache->m_Count[index]++;
+                return;
             }
         }
+
+        std::free(header);
     }
 
-    [[nodiscard]] inline NetworkManager::Network& NetworkManager::Connection::GetNetwork() noexcept {
-        return *m_Net;
+    [[nodiscard]] inline std::size_t NetworkManager::Allocator::GetClass(std::size_t size) noexcept
+    {
+        if(size <= MinBlockSize) {
+            return 0;
+        }
+
+        const auto index = static_cast<std::size_t>(std::bit_width(size - 1) - std::bit_width(MinBlockSize - 1));
+        return index < ClassCount ? index : ClassCount;
     }
 
-    [[nodiscard]] inline const NetworkManager::Network& NetworkManager::Connection::GetNetwork() const noexcept {
-        return *m_Net;
+    [[nodiscard]] inline NetworkManager::Allocator::Cache* NetworkManager::Allocator::GetCache() noexcept
+    {
+        // Free during thread teardown must not touch the destroyed cache, the flag is checked first
+        if(m_CacheDestroyed) {
+            return nullptr;
+        }
+
+        thread_local Cache cache{};
+        return &cache;
     }
 
-    inline void NetworkManager::Connection::SetUserData(std::unique_ptr<NetworkManager::UserData> data) {
-        const auto session = static_cast<NetworkManager::Session*>(m_Peer->data);
-        session->m_UserData = std::move(data);
+    inline void NetworkManager::Allocator::Count(std::atomic<std::uint64_t>& counter) noexcept {
+        // Only the owner thread writes, a plain store is enough and readers see whole values
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
     }
 
+
+    /* -------------- [NetworkManager::RingSPSC] ------------ */
     template <typename T>
-    requires std::is_base_of_v<NetworkManager::UserData, T>
-    [[nodiscard]] T* NetworkManager::Connection::GetUserData() noexcept
+    requires std::is_trivially_copyable_v<T>
+    [[nodiscard]] bool NetworkManager::RingSPSC<T>::Push(const T& value) noexcept
     {
-        if(Valid()) {
-            const auto session = static_cast<NetworkManager::Session*>(m_Peer->data);
-            return static_cast<T*>(session->m_UserData.get());   
+        const auto tail = m_Tail.load(std::memory_order_relaxed);
+        const auto size = tail - m_Head.load(std::memory_order_acquire);
+        if(size > m_Mask) {
+            return false;
         }
 
-        return nullptr;
+        m_Buffer[tail & m_Mask] = value;
+        m_Tail.store(tail + 1, std::memory_order_release);
+
+        if(size + 1 > m_Peak.load(std::memory_order_relaxed)) {
+            m_Peak.store(size + 1, std::memory_order_relaxed);
+        }
+
+        return true;
     }
 
     template <typename T>
-    requires std::is_base_of_v<NetworkManager::UserData, T>
-    [[nodiscard]] const T* NetworkManager::Connection::GetUserData() const noexcept 
+    requires std::is_trivially_copyable_v<T>
+    [[nodiscard]] bool NetworkManager::RingSPSC<T>::Pop(T& value) noexcept
     {
-        if(Valid()) {
-            const auto session = static_cast<const Session*>(m_Peer->data);
-            return static_cast<const T*>(session->m_UserData.get());
+        const auto head = m_Head.load(std::memory_order_relaxed);
+        if(head == m_Tail.load(std::memory_order_acquire)) {
+            return false;
         }
 
-        return nullptr;
+        value = m_Buffer[head & m_Mask];
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
     }
 
-    [[nodiscard]] inline std::uint32_t NetworkManager::Connection::GetID() const noexcept {
-        return enet_peer_get_id(m_Peer);
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    [[nodiscard]] std::size_t NetworkManager::RingSPSC<T>::Size() const noexcept {
+        return m_Tail.load(std::memory_order_acquire) - m_Head.load(std::memory_order_acquire);
     }
 
-    [[nodiscard]] inline NetworkManager::EStateConnection NetworkManager::Connection::GetState() const noexcept {
-        const auto session = static_cast<Session*>(m_Peer->data);
-        return session->m_State;
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    [[nodiscard]] std::size_t NetworkManager::RingSPSC<T>::Peak() const noexcept {
+        return m_Peak.load(std::memory_order_relaxed);
     }
 
-    [[nodiscard]] inline bool NetworkManager::Connection::Valid() const noexcept {
-        return m_Net && m_Peer && m_Peer->data && m_SequenceID == static_cast<const Session*>(m_Peer->data)->m_Sequence;
+
+    /* -------------- [NetworkManager::RingMPSC] ------------ */
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    NetworkManager::RingMPSC<T>::RingMPSC(std::size_t capacity)
+        : m_Buffer{std::make_unique<Cell[]>(std::bit_ceil(capacity))}, m_Mask{std::bit_ceil(capacity) - 1}, m_Head{}, m_Tail{}, m_Peak{}
+    {
+        for(std::size_t i = 0; i <= m_Mask; ++i) {
+            m_Buffer[i].m_Sequence.store(i, std::memory_order_relaxed);
+        }
     }
-    
 
-    /* -------------- [NetworkManager::Network] ------------- */
-    inline NetworkManager::Network::Network(std::uint16_t id) : m_Host{}, m_HandshakeList{}, m_UserData{}, m_NetworkID{id}, m_Server{}, m_Initialized{}
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    [[nodiscard]] bool NetworkManager::RingMPSC<T>::Push(const T& value) noexcept
     {
-        if(!enet_initialize()) {
-            m_Initialized = true;
-        } else {
-            HELENA_ASSERT(m_Initialized, "WinSock init failed");
-            Helena::Engine::Shutdown("Initialize network failed");
+        auto tail = m_Tail.load(std::memory_order_relaxed);
+        Cell* cell{};
+
+        while(true)
+        {
+            cell = &m_Buffer[tail & m_Mask];
+            const auto sequence = cell->m_Sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(tail);
+            if(!diff) {
+                if(m_Tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                return false;
+            } else {
+                tail = m_Tail.load(std::memory_order_relaxed);
+            }
         }
+
+        cell->m_Value = value;
+        cell->m_Sequence.store(tail + 1, std::memory_order_release);
+
+        const auto size = tail + 1 - m_Head.load(std::memory_order_relaxed);
+        auto peak = m_Peak.load(std::memory_order_relaxed);
+        while(size > peak && !m_Peak.compare_exchange_weak(peak, size, std::memory_order_relaxed)) {}
+
+        return true;
     }
 
-    inline NetworkManager::Network::~Network() 
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    [[nodiscard]] bool NetworkManager::RingMPSC<T>::Pop(T& value) noexcept
     {
-        Shutdown();
-        if(m_Initialized) {
-            enet_deinitialize();
+        const auto head = m_Head.load(std::memory_order_relaxed);
+        auto& cell = m_Buffer[head & m_Mask];
+        if(cell.m_Sequence.load(std::memory_order_acquire) != head + 1) {
+            return false;
         }
+
+        value = cell.m_Value;
+        cell.m_Sequence.store(head + m_Mask + 1, std::memory_order_release);
+        m_Head.store(head + 1, std::memory_order_release);
+        return true;
     }
 
-    inline NetworkManager::Network::Network(Network&& other) noexcept {
-        m_Host = other.m_Host;
-        m_UserData = std::move(other.m_UserData);
-        m_NetworkID = other.m_NetworkID;
-        m_Initialized = other.m_Initialized;
-        m_Server = other.m_Server;
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    [[nodiscard]] std::size_t NetworkManager::RingMPSC<T>::Size() const noexcept {
+        const auto head = m_Head.load(std::memory_order_acquire);
+        const auto tail = m_Tail.load(std::memory_order_acquire);
+        return tail > head ? tail - head : 0;
+    }
 
-        other.m_Host = nullptr;
+    template <typename T>
+    requires std::is_trivially_copyable_v<T>
+    [[nodiscard]] std::size_t NetworkManager::RingMPSC<T>::Peak() const noexcept {
+        return m_Peak.load(std::memory_order_relaxed);
     }
 
-    inline NetworkManager::Network& NetworkManager::Network::operator=(Network&& other) noexcept {
-        m_Host = other.m_Host;
-        m_UserData = std::move(other.m_UserData);
-        m_NetworkID = other.m_NetworkID;
-        m_Initialized = other.m_Initialized;
-        m_Server = other.m_Server;
 
-        other.m_Host = nullptr;
-        return *this;
+    /* --------------- [NetworkManager::Worker] ------------- */
+    inline NetworkManager::Worker::Worker(std::size_t capacity) : m_Thread{}, m_Inbound{capacity}, m_Outbound{capacity}, m_Running{}
+        , m_Event{-1}, m_Signaled{}, m_Watched{}, m_SentPackets{}, m_SendCalls{}, m_ReplacedCommands{}, m_ReceivedPackets{}, m_ReceiveCalls{}
+        , m_CookieReplies{}, m_CookieRejects{}, m_CookieTime{}, m_LimitedPackets{}, m_LimitedBytes{}, m_QueueDelay{}
+        , m_LatencyCount{}, m_LatencyTotal{}, m_LatencyMax{}
+    {
+    #ifdef __linux__
+        m_Event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    #endif
     }
 
-    [[nodiscard]] inline bool NetworkManager::Network::CreateServer(const Config& config) 
+    inline NetworkManager::Worker::~Worker()
     {
-        if(!m_Initialized) {
-            return false;
+    #ifdef __linux__
+        if(m_Event >= 0) {
+            close(m_Event);
         }
+    #endif
+    }
 
-        if(m_Host) {
-            HELENA_MSG_ERROR("Create server with ip: {}, port: {} failed: current network already used!",
-                config.GetIP(), config.GetPort());
-            return false;
+    inline void NetworkManager::Worker::Start(ENetHost* host) {
+        if(host->queueDelay) {
+            m_QueueDelay = std::vector<std::atomic<std::uint32_t>>(host->scheduleChannelCount * ENET_HOST_QUEUE_DELAY_BUCKETS);
         }
 
-        m_Server = true;
-        m_Host = CreateHost(config, m_Server);
-        return m_Host;
+        m_Running.store(true, std::memory_order_release);
+        m_Thread = std::thread{&Worker::Run, this, host};
     }
 
-    [[nodiscard]] inline bool NetworkManager::Network::CreateClient(const Config& config) 
+    inline void NetworkManager::Worker::Stop()
     {
-        if(!m_Initialized) {
+        m_Running.store(false, std::memory_order_release);
+        if(m_Thread.joinable()) {
+            m_Thread.join();
+        }
+
+        // Thread is stopped, drop everything not delivered
+        Inbound inbound{};
+        while(m_Inbound.Pop(inbound)) {
+            if(inbound.event.type == ENET_EVENT_TYPE_RECEIVE) {
+                enet_packet_destroy(inbound.event.packet);
+            }
+        }
+
+        Outbound command{};
+        while(m_Outbound.Pop(command)) {
+            if(command.packet && !command.packet->referenceCount) {
+                enet_packet_destroy(command.packet);
+            }
+        }
+    }
+
+    inline void NetworkManager::Worker::Post(const Outbound& command)
+    {
+        // Ring is bounded, producer wait for I/O thread instead of dropping reliable data
+        while(!m_Outbound.Push(command)) {
+            std::this_thread::yield();
+        }
+    }
+
+    inline void NetworkManager::Worker::Acknowledge()
+    {
+    #ifdef __linux__
+        // Flag is cleared first, push after it signals again and tick can't miss it
+        m_Signaled.store(false, std::memory_order_seq_cst);
+
+        std::uint64_t value{};
+        [[maybe_unused]] const auto result = read(m_Event, &value, sizeof(value));
+    #endif
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Worker::Deliver(const Inbound& inbound)
+    {
+        if(!m_Inbound.Push(inbound)) {
             return false;
         }
 
-        if(m_Host && m_Server) {
-            HELENA_MSG_ERROR("Client connection cannot be created inside server network!");
-            return false;
-        }
-        
-        if(!m_Host) {
-            m_Server = false;
-            m_Host = CreateHost(config, m_Server);
+    #ifdef __linux__
+        if(m_Event >= 0 && !m_Signaled.exchange(true, std::memory_order_seq_cst)) {
+            const std::uint64_t value = 1;
+            [[maybe_unused]] const auto result = write(m_Event, &value, sizeof(value));
+        }
+    #endif
+
+        return true;
+    }
+
+    [[nodiscard]] inline std::int64_t NetworkManager::Worker::GetTime() noexcept {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    inline void NetworkManager::Worker::Run(ENetHost* host)
+    {
+        constexpr std::uint32_t serviceTimeout = 1;
+
+        // Events the tick had no room for, delivered in order before the host is serviced again
+        std::deque<Inbound> pending;
+
+        while(m_Running.load(std::memory_order_acquire))
+        {
+            while(!pending.empty() && Deliver(pending.front())) {
+                pending.pop_front();
+            }
+
+            // Commands run while events wait, the tick may be blocked in Post until outbound ring has space
+            Outbound command{};
+            Inbound inbound{};
+            while(m_Outbound.Pop(command)) {
+                if(Execute(host, command, inbound) && (!pending.empty() || !Deliver(inbound))) {
+                    pending.push_back(inbound);
+                }
+            }
+
+            if(!pending.empty()) {
+                // Tick is behind, stop servicing until ring has space
+                std::this_thread::yield();
+                continue;
+            }
+
+            ENetEvent event{};
+            if(enet_host_check_events(host, &event) > 0 || enet_host_service(host, &event, serviceTimeout) > 0)
+            {
+                inbound.event = event;
+                inbound.time = GetTime();
+                inbound.connectID = event.peer ? event.peer->connectID : 0;
+                if(!Deliver(inbound)) {
+                    pending.push_back(inbound);
+                }
+            }
+
+            m_SentPackets.store(enet_host_get_packets_sent(host), std::memory_order_relaxed);
+            m_SendCalls.store(enet_host_get_send_calls(host), std::memory_order_relaxed);
+            m_ReplacedCommands.store(enet_host_get_replaced_commands(host), std::memory_order_relaxed);
+            m_ReceivedPackets.store(enet_host_get_packets_received(host), std::memory_order_relaxed);
+            m_ReceiveCalls.store(enet_host_get_receive_calls(host), std::memory_order_relaxed);
+            m_CookieReplies.store(enet_host_get_cookie_replies(host), std::memory_order_relaxed);
+            m_CookieRejects.store(enet_host_get_cookie_rejects(host), std::memory_order_relaxed);
+            m_CookieTime.store(enet_host_get_cookie_time(host), std::memory_order_relaxed);
+            m_LimitedPackets.store(enet_host_get_limited_packets(host), std::memory_order_relaxed);
+            m_LimitedBytes.store(enet_host_get_limited_bytes(host), std::memory_order_relaxed);
+            for(std::size_t index = 0; index < m_QueueDelay.size(); ++index) {
+                m_QueueDelay[index].store(host->queueDelay[index], std::memory_order_relaxed);
+            }
+        }
+
+        for(const auto& inbound : pending) {
+            if(inbound.event.type == ENET_EVENT_TYPE_RECEIVE) {
+                enet_packet_destroy(inbound.event.packet);
+            }
+        }
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Worker::Execute(ENetHost* host, const Outbound& command, Inbound& inbound)
+    {
+        const auto peer = command.peer;
+        const auto match = peer && peer->connectID == command.connectID;
+
+        switch(command.type)
+        {
+            case ECommand::Send: {
+                if(!match || enet_peer_send_latest(peer, command.channel, command.packet, command.data)) {
+                    if(!command.packet->referenceCount) {
+                        enet_packet_destroy(command.packet);
+                    }
+                }
+            } break;
+            case ECommand::SendShared: {
+                if(match) {
+                    (void)enet_peer_send(peer, command.channel, command.packet);
+                }
+
+                if(!--command.packet->referenceCount) {
+                    enet_packet_destroy(command.packet);
+                }
+            } break;
+            case ECommand::Broadcast: {
+                enet_host_broadcast(host, command.channel, command.packet);
+            } break;
+            case ECommand::Connect:
+            {
+                if(const auto connection = enet_host_connect(host, &command.address, command.channel, command.data)) {
+                    // Session of new connection is prepared by the tick
+                    inbound.event = ENetEvent{};
+                    inbound.event.peer = connection;
+                    inbound.time = GetTime();
+                    inbound.connectID = connection->connectID;
+                    return true;
+                }
+
+                HELENA_MSG_ERROR("Connect to server port: {} failed!", command.address.port);
+            } break;
+            case ECommand::Disconnect:      if(match) enet_peer_disconnect(peer, command.data); break;
+            case ECommand::DisconnectLater: if(match) enet_peer_disconnect_later(peer, command.data); break;
+            case ECommand::DisconnectNow:   if(match) enet_peer_disconnect_now(peer, command.data); break;
+            case ECommand::Reset:           if(match) enet_peer_reset(peer); break;
+        }
+
+        return false;
+    }
+
+
+    /* --------------- [NetworkManager::Poller] ------------- */
+#ifdef __linux__
+    inline NetworkManager::Poller::Poller() : m_Events{}, m_Count{}, m_Handle{epoll_create1(EPOLL_CLOEXEC)} {
+        HELENA_ASSERT(m_Handle >= 0, "epoll create failed");
+    }
+
+    inline NetworkManager::Poller::~Poller() {
+        if(m_Handle >= 0) {
+            close(m_Handle);
+        }
+    }
+
+    inline void NetworkManager::Poller::Watch(ENetSocket socket, bool& watched)
+    {
+        if(!watched)
+        {
+            // Closed sockets leave epoll by itself, watched flag dies together with its shard
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.fd = socket;
+            watched = !epoll_ctl(m_Handle, EPOLL_CTL_ADD, socket, &event);
+        }
+    }
+
+    inline void NetworkManager::Poller::Unwatch(ENetSocket socket, bool& watched)
+    {
+        if(watched) {
+            epoll_ctl(m_Handle, EPOLL_CTL_DEL, socket, nullptr);
+            watched = false;
+        }
+    }
+
+    inline void NetworkManager::Poller::Wait(std::uint32_t timeout)
+    {
+        const auto count = epoll_wait(m_Handle, m_Events.data(), static_cast<int>(m_Events.size()), static_cast<int>(timeout));
+        m_Count = count > 0 ? static_cast<std::size_t>(count) : 0;
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Poller::Ready(ENetSocket socket) const noexcept {
+        return std::any_of(m_Events.cbegin(), m_Events.cbegin() + m_Count, [socket](const auto& event) {
+            return event.data.fd == socket;
+        });
+    }
+#else
+    inline NetworkManager::Poller::Poller() : m_Watch{}, m_Ready{}, m_MaxSocket{}, m_Empty{true} {
+        FD_ZERO(&m_Watch);
+        FD_ZERO(&m_Ready);
+    }
+
+    inline NetworkManager::Poller::~Poller() = default;
+
+    inline void NetworkManager::Poller::Watch(ENetSocket socket, bool& watched)
+    {
+        FD_SET(socket, &m_Watch);
+        m_MaxSocket = std::max(m_MaxSocket, socket);
+        m_Empty = false;
+        watched = true;
+    }
+
+    inline void NetworkManager::Poller::Unwatch(ENetSocket, bool& watched) {
+        watched = false;
+    }
+
+    inline void NetworkManager::Poller::Wait(std::uint32_t timeout)
+    {
+        if(m_Empty) {
+            // select fails without sockets on Windows
+            FD_ZERO(&m_Ready);
+            std::this_thread::sleep_for(std::chrono::milliseconds{timeout});
+            return;
+        }
+
+        m_Ready = m_Watch;
+        if(enet_socket_set_select(m_MaxSocket, &m_Ready, nullptr, timeout) < 0) {
+            FD_ZERO(&m_Ready);
+        }
+
+        FD_ZERO(&m_Watch);
+        m_MaxSocket = {};
+        m_Empty = true;
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Poller::Ready(ENetSocket socket) const noexcept {
+        return FD_ISSET(socket, const_cast<ENetSocketSet*>(&m_Ready));
+    }
+#endif
+
+    /* ----------- [NetworkManager::HandshakeWheel] ---------- */
+    inline void NetworkManager::HandshakeWheel::Resize(std::size_t peers) {
+        Clear();
+        m_Nodes.assign(peers, Node{nullptr, None, None, 0});
+    }
+
+    inline void NetworkManager::HandshakeWheel::Clear() noexcept {
+        m_Nodes.clear();
+        m_Slots.fill(None);
+        m_Pending = 0;
+    }
+
+    inline void NetworkManager::HandshakeWheel::Add(std::uint32_t id, ENetPeer* peer, std::uint32_t expire)
+    {
+        HELENA_ASSERT(id < m_Nodes.size(), "Handshake peer id: {} out of range", id);
+
+        if(m_Nodes[id].m_Peer) {
+            Unlink(id);
+        }
+
+        const auto slot = expire / SlotTime % SlotCount;
+        auto& node = m_Nodes[id];
+        node = Node{peer, None, m_Slots[slot], expire};
+
+        if(node.m_Next != None) {
+            m_Nodes[node.m_Next].m_Prev = id;
+        }
+
+        m_Slots[slot] = id;
+        m_Pending++;
+    }
+
+    inline void NetworkManager::HandshakeWheel::Remove(std::uint32_t id) noexcept {
+        if(id < m_Nodes.size() && m_Nodes[id].m_Peer) {
+            Unlink(id);
+        }
+    }
+
+    inline void NetworkManager::HandshakeWheel::Unlink(std::uint32_t id) noexcept
+    {
+        auto& node = m_Nodes[id];
+        if(node.m_Prev != None) {
+            m_Nodes[node.m_Prev].m_Next = node.m_Next;
+        } else {
+            m_Slots[node.m_Expire / SlotTime % SlotCount] = node.m_Next;
+        }
+
+        if(node.m_Next != None) {
+            m_Nodes[node.m_Next].m_Prev = node.m_Prev;
+        }
+
+        node.m_Peer = nullptr;
+        m_Pending--;
+    }
+
+    template <typename Func>
+    void NetworkManager::HandshakeWheel::Expire(std::uint32_t time, Func&& func)
+    {
+        // Walk slots passed since last call, whole wheel if it was idle for a turn
+        const auto passed = time / SlotTime - m_Time / SlotTime;
+        const auto count = m_Pending ? std::min<std::uint32_t>(passed + 1, SlotCount) : 0;
+        const auto first = m_Time / SlotTime;
+        m_Time = time;
+
+        for(std::uint32_t index = 0; index < count && m_Pending; ++index)
+        {
+            auto id = m_Slots[(first + index) % SlotCount];
+            while(id != None)
+            {
+                const auto& node = m_Nodes[id];
+                const auto next = node.m_Next;
+                if(ENET_TIME_LESS_EQUAL(node.m_Expire, time)) {
+                    const auto peer = node.m_Peer;
+                    Unlink(id);
+                    m_Expired++;
+                    func(peer);
+                }
+
+                id = next;
+            }
+        }
+    }
+
+    [[nodiscard]] inline std::size_t NetworkManager::HandshakeWheel::Pending() const noexcept {
+        return m_Pending;
+    }
+
+    [[nodiscard]] inline std::uint64_t NetworkManager::HandshakeWheel::Expired() const noexcept {
+        return m_Expired;
+    }
+
+    /* --------------- [NetworkManager::Cipher] ------------- */
+    inline void NetworkManager::Cipher::Poly1305::Init(const std::uint8_t* key) noexcept
+    {
+        // Clamped r in 26 bit limbs
+        m_R[0] = (Load32(key +  0) >> 0) & 0x3FFFFFF;
+        m_R[1] = (Load32(key +  3) >> 2) & 0x3FFFF03;
+        m_R[2] = (Load32(key +  6) >> 4) & 0x3FFC0FF;
+        m_R[3] = (Load32(key +  9) >> 6) & 0x3F03FFF;
+        m_R[4] = (Load32(key + 12) >> 8) & 0x00FFFFF;
+
+        for(std::size_t index = 0; index < 4; ++index) {
+            m_Pad[index] = Load32(key + 16 + index * 4);
+        }
+
+        std::fill(std::begin(m_H), std::end(m_H), 0);
+        m_Leftover = 0;
+    }
+
+    inline void NetworkManager::Cipher::Poly1305::Update(const std::uint8_t* data, std::size_t size) noexcept
+    {
+        constexpr std::uint32_t hibit = 1u << 24;
+
+        if(m_Leftover) {
+            const auto length = std::min(size, sizeof(m_Buffer) - m_Leftover);
+            std::memcpy(m_Buffer + m_Leftover, data, length);
+            m_Leftover += length;
+            data += length;
+            size -= length;
+
+            if(m_Leftover < sizeof(m_Buffer)) {
+                return;
+            }
+
+            Blocks(m_Buffer, sizeof(m_Buffer), hibit);
+            m_Leftover = 0;
+        }
+
+        if(const auto length = size & ~std::size_t{15}) {
+            Blocks(data, length, hibit);
+            data += length;
+            size -= length;
+        }
+
+        if(size) {
+            std::memcpy(m_Buffer, data, size);
+            m_Leftover = size;
+        }
+    }
+
+    inline void NetworkManager::Cipher::Poly1305::Pad() noexcept
+    {
+        if(m_Leftover) {
+            std::memset(m_Buffer + m_Leftover, 0, sizeof(m_Buffer) - m_Leftover);
+            Blocks(m_Buffer, sizeof(m_Buffer), 1u << 24);
+            m_Leftover = 0;
+        }
+    }
+
+    inline void NetworkManager::Cipher::Poly1305::Finish(std::uint8_t* tag) noexcept
+    {
+        constexpr std::uint32_t mask26 = 0x3FFFFFF;
+
+        if(m_Leftover) {
+            m_Buffer[m_Leftover] = 1;
+            std::memset(m_Buffer + m_Leftover + 1, 0, sizeof(m_Buffer) - m_Leftover - 1);
+            Blocks(m_Buffer, sizeof(m_Buffer), 0);
+        }
+
+        auto [h0, h1, h2, h3, h4] = m_H;
+        std::uint32_t carry;
+
+        // Full carry of h
+        carry = h1 >> 26; h1 &= mask26; h2 += carry;
+        carry = h2 >> 26; h2 &= mask26; h3 += carry;
+        carry = h3 >> 26; h3 &= mask26; h4 += carry;
+        carry = h4 >> 26; h4 &= mask26; h0 += carry * 5;
+        carry = h0 >> 26; h0 &= mask26; h1 += carry;
+
+        // h - p, selected in constant time when h >= p
+        auto g0 = h0 + 5; carry = g0 >> 26; g0 &= mask26;
+        auto g1 = h1 + carry; carry = g1 >> 26; g1 &= mask26;
+        auto g2 = h2 + carry; carry = g2 >> 26; g2 &= mask26;
+        auto g3 = h3 + carry; carry = g3 >> 26; g3 &= mask26;
+        auto g4 = h4 + carry - (1u << 26);
+
+        auto select = (g4 >> 31) - 1;
+        g0 &= select; g1 &= select; g2 &= select; g3 &= select; g4 &= select;
+        select = ~select;
+        h0 = (h0 & select) | g0;
+        h1 = (h1 & select) | g1;
+        h2 = (h2 & select) | g2;
+        h3 = (h3 & select) | g3;
+        h4 = (h4 & select) | g4;
+
+        // h + s mod 2^128
+        const std::uint32_t words[4] = {
+            h0 | h1 << 26,
+            h1 >> 6 | h2 << 20,
+            h2 >> 12 | h3 << 14,
+            h3 >> 18 | h4 << 8
+        };
+
+        std::uint64_t sum{};
+        for(std::size_t index = 0; index < 4; ++index) {
+            sum = static_cast<std::uint64_t>(words[index]) + m_Pad[index] + (sum >> 32);
+            Store32(tag + index * 4, static_cast<std::uint32_t>(sum));
+        }
+    }
+
+    inline void NetworkManager::Cipher::Poly1305::Blocks(const std::uint8_t* data, std::size_t size, std::uint32_t hibit) noexcept
+    {
+        constexpr std::uint32_t mask26 = 0x3FFFFFF;
+
+        const auto [r0, r1, r2, r3, r4] = m_R;
+        const auto s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+        auto [h0, h1, h2, h3, h4] = m_H;
+
+        for(; size >= 16; data += 16, size -= 16)
+        {
+            h0 += (Load32(data +  0) >> 0) & mask26;
+            h1 += (Load32(data +  3) >> 2) & mask26;
+            h2 += (Load32(data +  6) >> 4) & mask26;
+            h3 += (Load32(data +  9) >> 6) & mask26;
+            h4 += (Load32(data + 12) >> 8) | hibit;
+
+            const auto mul = [](std::uint32_t a, std::uint32_t b) noexcept { return static_cast<std::uint64_t>(a) * b; };
+            const auto d0 = mul(h0, r0) + mul(h1, s4) + mul(h2, s3) + mul(h3, s2) + mul(h4, s1);
+            auto d1 = mul(h0, r1) + mul(h1, r0) + mul(h2, s4) + mul(h3, s3) + mul(h4, s2);
+            auto d2 = mul(h0, r2) + mul(h1, r1) + mul(h2, r0) + mul(h3, s4) + mul(h4, s3);
+            auto d3 = mul(h0, r3) + mul(h1, r2) + mul(h2, r1) + mul(h3, r0) + mul(h4, s4);
+            auto d4 = mul(h0, r4) + mul(h1, r3) + mul(h2, r2) + mul(h3, r1) + mul(h4, r0);
+
+            // Partial carry, h stays below 2^130 + small
+            std::uint32_t carry = static_cast<std::uint32_t>(d0 >> 26); h0 = static_cast<std::uint32_t>(d0) & mask26;
+            d1 += carry; carry = static_cast<std::uint32_t>(d1 >> 26); h1 = static_cast<std::uint32_t>(d1) & mask26;
+            d2 += carry; carry = static_cast<std::uint32_t>(d2 >> 26); h2 = static_cast<std::uint32_t>(d2) & mask26;
+            d3 += carry; carry = static_cast<std::uint32_t>(d3 >> 26); h3 = static_cast<std::uint32_t>(d3) & mask26;
+            d4 += carry; carry = static_cast<std::uint32_t>(d4 >> 26); h4 = static_cast<std::uint32_t>(d4) & mask26;
+            h0 += carry * 5; carry = h0 >> 26; h0 &= mask26;
+            h1 += carry;
+        }
+
+        m_H[0] = h0; m_H[1] = h1; m_H[2] = h2; m_H[3] = h3; m_H[4] = h4;
+    }
+
+    inline void NetworkManager::Cipher::Seal(const Key& key, const std::uint8_t* nonce, const std::uint8_t* aad, std::size_t aadSize,
+        const std::uint8_t* data, std::size_t size, std::uint8_t* out) noexcept
+    {
+        // Block 0 is the one-time Poly1305 key, payload starts from block 1
+        std::uint32_t state[16];
+        std::uint8_t polyKey[BlockSize];
+        Setup(state, key, nonce, 0);
+        Block(state, polyKey);
+
+        state[12] = 1;
+        Xor(state, data, size, out);
+        Authenticate(polyKey, aad, aadSize, out, size, out + size);
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Cipher::Open(const Key& key, const std::uint8_t* nonce, const std::uint8_t* aad, std::size_t aadSize,
+        const std::uint8_t* data, std::size_t size, std::uint8_t* out) noexcept
+    {
+        if(size < TagSize) {
+            return false;
+        }
+
+        size -= TagSize;
+
+        std::uint32_t state[16];
+        std::uint8_t polyKey[BlockSize];
+        Setup(state, key, nonce, 0);
+        Block(state, polyKey);
+
+        std::uint8_t tag[TagSize];
+        Authenticate(polyKey, aad, aadSize, data, size, tag);
+
+        // Constant time compare, nothing is decrypted on mismatch
+        std::uint8_t diff{};
+        for(std::size_t index = 0; index < TagSize; ++index) {
+            diff |= tag[index] ^ data[size + index];
+        }
+
+        if(diff) {
+            return false;
+        }
+
+        state[12] = 1;
+        Xor(state, data, size, out);
+        return true;
+    }
+
+    [[nodiscard]] inline NetworkManager::Cipher::Key NetworkManager::Cipher::Derive(const Key& key, const std::uint8_t* input) noexcept
+    {
+        std::uint32_t x[16];
+        Setup(x, key, input + 4, Load32(input));
+        Rounds(x);
+
+        Key result;
+        for(std::size_t index = 0; index < 4; ++index) {
+            Store32(result.data() + index * 4, x[index]);
+            Store32(result.data() + 16 + index * 4, x[12 + index]);
+        }
+
+        return result;
+    }
+
+    [[nodiscard]] inline std::uint32_t NetworkManager::Cipher::GetKeyID(const Key& key) noexcept {
+        constexpr std::array<std::uint8_t, 16> input{};
+        return Load32(Derive(key, input.data()).data());
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Cipher::Check(const State& state, std::uint64_t sequence) noexcept
+    {
+        if(sequence > state.m_ReceiveSequence) {
+            return true;
+        }
+
+        const auto offset = state.m_ReceiveSequence - sequence;
+        return offset < WindowSize && !(state.m_Window[offset / 64] >> offset % 64 & 1);
+    }
+
+    inline void NetworkManager::Cipher::Accept(State& state, std::uint64_t sequence) noexcept
+    {
+        // Bit n of the window is sequence m_ReceiveSequence - n
+        if(sequence > state.m_ReceiveSequence)
+        {
+            const auto shift = sequence - state.m_ReceiveSequence;
+            if(shift >= WindowSize) {
+                state.m_Window.fill(0);
+            } else {
+                const auto words = static_cast<std::size_t>(shift / 64);
+                const auto bits = static_cast<std::size_t>(shift % 64);
+                for(auto index = state.m_Window.size(); index-- > 0;) {
+                    std::uint64_t value{};
+                    if(index >= words) {
+                        value = state.m_Window[index - words] << bits;
+                        if(bits && index > words) {
+                            value |= state.m_Window[index - words - 1] >> (64 - bits);
+                        }
+                    }
+                    state.m_Window[index] = value;
+                }
+            }
+
+            state.m_ReceiveSequence = sequence;
+        }
+
+        const auto offset = state.m_ReceiveSequence - sequence;
+        state.m_Window[offset / 64] |= std::uint64_t{1} << offset % 64;
+    }
+
+    inline void NetworkManager::Cipher::Random(std::uint8_t* data, std::size_t size)
+    {
+        std::random_device device;
+        for(std::size_t index = 0; index < size; index += sizeof(std::uint32_t)) {
+            const auto value = static_cast<std::uint32_t>(device());
+            std::memcpy(data + index, &value, std::min(size - index, sizeof(value)));
+        }
+    }
+
+    inline void NetworkManager::Cipher::Setup(std::uint32_t* state, const Key& key, const std::uint8_t* nonce, std::uint32_t counter) noexcept
+    {
+        // "expand 32-byte k"
+        state[0] = 0x61707865;
+        state[1] = 0x3320646E;
+        state[2] = 0x79622D32;
+        state[3] = 0x6B206574;
+
+        for(std::size_t index = 0; index < 8; ++index) {
+            state[4 + index] = Load32(key.data() + index * 4);
+        }
+
+        state[12] = counter;
+        for(std::size_t index = 0; index < 3; ++index) {
+            state[13 + index] = Load32(nonce + index * 4);
+        }
+    }
+
+    inline void NetworkManager::Cipher::Block(const std::uint32_t* state, std::uint8_t* out) noexcept
+    {
+        std::uint32_t x[16];
+        std::memcpy(x, state, sizeof(x));
+        Rounds(x);
+
+        for(std::size_t index = 0; index < 16; ++index) {
+            Store32(out + index * 4, x[index] + state[index]);
+        }
+    }
+
+    inline void NetworkManager::Cipher::Xor(std::uint32_t* state, const std::uint8_t* data, std::size_t size, std::uint8_t* out) noexcept
+    {
+        alignas(64) std::uint8_t stream[BlockSize * Lanes];
+
+        while(size)
+        {
+            std::size_t length;
+#if defined(__GNUC__) || defined(__clang__)
+            if(size > BlockSize * 2) {
+                Blocks(state, stream);
+                state[12] += Lanes;
+                length = std::min(size, sizeof(stream));
+            } else
+#endif
+            {
+                Block(state, stream);
+                state[12]++;
+                length = std::min(size, BlockSize);
+            }
+
+            // Ascending order, out may overlap data from below
+            for(std::size_t index = 0; index < length; ++index) {
+                out[index] = data[index] ^ stream[index];
+            }
+
+            data += length;
+            out += length;
+            size -= length;
+        }
+    }
+
+    inline void NetworkManager::Cipher::Authenticate(const std::uint8_t* key, const std::uint8_t* aad, std::size_t aadSize,
+        const std::uint8_t* data, std::size_t size, std::uint8_t* tag) noexcept
+    {
+        Poly1305 poly;
+        poly.Init(key);
+        poly.Update(aad, aadSize);
+        poly.Pad();
+        poly.Update(data, size);
+        poly.Pad();
+
+        std::uint8_t lengths[16];
+        Store64(lengths, aadSize);
+        Store64(lengths + 8, size);
+        poly.Update(lengths, sizeof(lengths));
+        poly.Finish(tag);
+    }
+
+    template <typename T>
+    HELENA_CIPHER_INLINE void NetworkManager::Cipher::Quarter(T& a, T& b, T& c, T& d) noexcept
+    {
+        a += b; d ^= a; d = d << 16 | d >> 16;
+        c += d; b ^= c; b = b << 12 | b >> 20;
+        a += b; d ^= a; d = d <<  8 | d >> 24;
+        c += d; b ^= c; b = b <<  7 | b >> 25;
+    }
+
+    template <typename T>
+    HELENA_CIPHER_INLINE void NetworkManager::Cipher::Rounds(T (&x)[16]) noexcept
+    {
+        // Same code for one block in scalars and for Lanes blocks in vectors, state is kept in registers
+        auto [x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15] = x;
+        for(int round = 0; round < 10; ++round) {
+            Quarter(x0, x4,  x8, x12);
+            Quarter(x1, x5,  x9, x13);
+            Quarter(x2, x6, x10, x14);
+            Quarter(x3, x7, x11, x15);
+            Quarter(x0, x5, x10, x15);
+            Quarter(x1, x6, x11, x12);
+            Quarter(x2, x7,  x8, x13);
+            Quarter(x3, x4,  x9, x14);
+        }
+
+        x[0] = x0; x[1] = x1; x[2] = x2; x[3] = x3; x[4] = x4; x[5] = x5; x[6] = x6; x[7] = x7;
+        x[8] = x8; x[9] = x9; x[10] = x10; x[11] = x11; x[12] = x12; x[13] = x13; x[14] = x14; x[15] = x15;
+    }
+
+#if defined(__GNUC__) || defined(__clang__)
+    inline void NetworkManager::Cipher::Blocks(const std::uint32_t* state, std::uint8_t* out) noexcept
+    {
+#if defined(__x86_64__) && !defined(HELENA_CIPHER_NO_AVX2)
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        if(avx2) {
+            BlocksAvx2(state, out);
+            return;
+        }
+#endif
+        BlocksGeneric(state, out);
+    }
+
+    HELENA_CIPHER_INLINE void NetworkManager::Cipher::BlocksVector(const std::uint32_t* state, std::uint8_t* out) noexcept
+    {
+        // Lane n computes block with counter + n
+        Vector input[16];
+        Vector x[16];
+        for(std::size_t index = 0; index < 16; ++index) {
+            input[index] = Vector{} + state[index];
+        }
+
+        input[12] += Vector{0, 1, 2, 3, 4, 5, 6, 7};
+        std::memcpy(x, input, sizeof(x));
+        Rounds(x);
+
+        for(std::size_t index = 0; index < 16; ++index) {
+            x[index] += input[index];
+        }
+
+        for(std::size_t lane = 0; lane < Lanes; ++lane) {
+            for(std::size_t index = 0; index < 16; ++index) {
+                Store32(out + lane * BlockSize + index * 4, x[index][lane]);
+            }
+        }
+    }
+
+    inline void NetworkManager::Cipher::BlocksGeneric(const std::uint32_t* state, std::uint8_t* out) noexcept {
+        BlocksVector(state, out);
+    }
+
+#if defined(__x86_64__)
+    __attribute__((target("avx2"))) inline void NetworkManager::Cipher::BlocksAvx2(const std::uint32_t* state, std::uint8_t* out) noexcept {
+        BlocksVector(state, out);
+    }
+#endif
+#endif
+
+    [[nodiscard]] inline std::uint32_t NetworkManager::Cipher::Load32(const std::uint8_t* data) noexcept {
+        return static_cast<std::uint32_t>(data[0]) | static_cast<std::uint32_t>(data[1]) << 8
+            | static_cast<std::uint32_t>(data[2]) << 16 | static_cast<std::uint32_t>(data[3]) << 24;
+    }
+
+    inline void NetworkManager::Cipher::Store32(std::uint8_t* data, std::uint32_t value) noexcept {
+        for(std::size_t index = 0; index < sizeof(value); ++index) {
+            data[index] = static_cast<std::uint8_t>(value >> index * 8);
+        }
+    }
+
+    inline void NetworkManager::Cipher::Store64(std::uint8_t* data, std::uint64_t value) noexcept {
+        for(std::size_t index = 0; index < sizeof(value); ++index) {
+            data[index] = static_cast<std::uint8_t>(value >> index * 8);
+        }
+    }
+
+    /* ------------- [NetworkManager::Compressor] ------------ */
+    inline NetworkManager::Compressor::Compressor(std::vector<std::uint8_t> dictionary) 
+        : m_Dictionary{std::move(dictionary)}, m_DictionaryTable(1u << HashBits, None), m_Table(1u << HashBits), m_Hash{2166136261u}, m_Generation{}
+    {
+        // Offsets are 16 bit, only the dictionary tail is reachable
+        if(m_Dictionary.size() > MaxInput) {
+            m_Dictionary.erase(m_Dictionary.begin(), m_Dictionary.end() - MaxInput);
+        }
+
+        for(std::uint32_t position = 0; position + MinMatch <= m_Dictionary.size(); ++position) {
+            m_DictionaryTable[Hash(Read32(m_Dictionary.data() + position))] = position;
+        }
+
+        // FNV-1a, compared by handshake
+        for(const auto byte : m_Dictionary) {
+            m_Hash = (m_Hash ^ byte) * 16777619u;
+        }
+    }
+
+    [[nodiscard]] inline std::uint32_t NetworkManager::Compressor::Compress(const std::uint8_t* data, std::uint32_t size, std::uint8_t* out, std::uint32_t capacity) noexcept
+    {
+        if(size > MaxInput || size < MinMatch) {
+            return 0;
+        }
+
+        // Table entries of previous calls are skipped by generation
+        if(!++m_Generation) {
+            std::fill(m_Table.begin(), m_Table.end(), 0);
+            m_Generation = 1;
+        }
+
+        const auto dictionary = m_Dictionary.data();
+        const auto dictionarySize = static_cast<std::uint32_t>(m_Dictionary.size());
+
+        // Source position counts dictionary first and payload after it
+        const auto at = [&](std::uint32_t position) noexcept {
+            return position < dictionarySize ? dictionary[position] : data[position - dictionarySize];
+        };
+
+        std::uint32_t written{};
+        const auto putLength = [&](std::uint32_t length) noexcept {
+            for(; length >= 255; length -= 255) {
+                if(written == capacity) return false;
+                out[written++] = 255;
+            }
+
+            if(written == capacity) return false;
+            out[written++] = static_cast<std::uint8_t>(length);
+            return true;
+        };
+
+        const auto putSequence = [&](std::uint32_t anchor, std::uint32_t literals, std::uint32_t offset, std::uint32_t match) noexcept
+        {
+            if(written == capacity) return false;
+            out[written++] = static_cast<std::uint8_t>(std::min<std::uint32_t>(literals, 15) << 4 | (match ? std::min<std::uint32_t>(match - MinMatch, 15) : 0));
+            if(literals >= 15 && !putLength(literals - 15)) return false;
+            if(literals > capacity - written) return false;
+            std::memcpy(out + written, data + anchor, literals);
+            written += literals;
+
+            if(!match) return true;
+            if(capacity - written < 2) return false;
+            out[written++] = static_cast<std::uint8_t>(offset);
+            out[written++] = static_cast<std::uint8_t>(offset >> 8);
+            return match - MinMatch < 15 || putLength(match - MinMatch - 15);
+        };
+
+        std::uint32_t anchor{};
+        for(std::uint32_t position = 0; position + MinMatch <= size;)
+        {
+            const auto value = Read32(data + position);
+            const auto hash = Hash(value);
+            const auto entry = m_Table[hash];
+            m_Table[hash] = static_cast<std::uint32_t>(m_Generation) << 16 | position;
+
+            auto source = None;
+            if(entry >> 16 == m_Generation && (entry & 0xFFFF) < position && Read32(data + (entry & 0xFFFF)) == value) {
+                source = dictionarySize + (entry & 0xFFFF);
+            } else if(const auto candidate = m_DictionaryTable[hash]; candidate != None 
+                && dictionarySize + position - candidate <= MaxInput && Read32(dictionary + candidate) == value) {
+                source = candidate;
+            }
+
+            if(source == None) {
+                position++;
+                continue;
+            }
+
+            auto match = MinMatch;
+            while(position + match < size && at(source + match) == data[position + match]) {
+                match++;
+            }
+
+            if(!putSequence(anchor, position - anchor, dictionarySize + position - source, match)) {
+                return 0;
+            }
+
+            position += match;
+            anchor = position;
+        }
+
+        return putSequence(anchor, size - anchor, 0, 0) ? written : 0;
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Compressor::Decompress(const std::uint8_t* data, std::uint32_t size, std::uint8_t* out, std::uint32_t outSize) const noexcept
+    {
+        const auto dictionarySize = static_cast<std::uint32_t>(m_Dictionary.size());
+        std::uint32_t read{};
+        std::uint32_t written{};
+
+        const auto getLength = [&](std::uint32_t& length) noexcept {
+            for(std::uint8_t byte = 255; byte == 255;) {
+                if(read == size) return false;
+                byte = data[read++];
+                length += byte;
+            }
+            return true;
+        };
+
+        while(read < size)
+        {
+            const auto token = data[read++];
+            std::uint32_t literals = token >> 4;
+            if(literals == 15 && !getLength(literals)) {
+                return false;
+            }
+
+            if(literals > size - read || literals > outSize - written) {
+                return false;
+            }
+
+            std::memcpy(out + written, data + read, literals);
+            read += literals;
+            written += literals;
+
+            // Last sequence has literals only
+            if(read == size) {
+                break;
+            }
+
+            if(size - read < 2) {
+                return false;
+            }
+
+            const std::uint32_t offset = data[read] | data[read + 1] << 8;
+            read += 2;
+
+            std::uint32_t match = token & 15;
+            if(match == 15 && !getLength(match)) {
+                return false;
+            }
+
+            match += MinMatch;
+            if(!offset || offset > written + dictionarySize || match > outSize - written) {
+                return false;
+            }
+
+            if(offset <= written && offset >= match) {
+                std::memcpy(out + written, out + written - offset, match);
+                written += match;
+                continue;
+            }
+
+            for(const auto end = written + match; written < end; ++written) {
+                out[written] = offset > written ? m_Dictionary[dictionarySize - (offset - written)] : out[written - offset];
+            }
+        }
+
+        return written == outSize;
+    }
+
+    [[nodiscard]] inline std::uint32_t NetworkManager::Compressor::GetHash() const noexcept {
+        return m_Hash;
+    }
+
+    [[nodiscard]] inline std::uint32_t NetworkManager::Compressor::Read32(const std::uint8_t* data) noexcept {
+        std::uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    [[nodiscard]] inline std::uint32_t NetworkManager::Compressor::Hash(std::uint32_t value) noexcept {
+        return (value * 2654435761u) >> (32 - HashBits);
+    }
+
+
+    /* -------------- [NetworkManager::Packet] -------------- */
+    inline NetworkManager::Packet::Packet(ENetPacket* packet) noexcept : m_Packet{packet}, m_Capacity{packet->dataLength} {
+        packet->referenceCount = 1;
+    }
+
+    inline NetworkManager::Packet::Packet(std::uint32_t size) : m_Packet{enet_packet_create(nullptr, size, 0)}, m_Capacity{}
+    {
+        if(m_Packet) {
+            m_Packet->referenceCount = 1;
+            m_Capacity = size;
+        } else {
+            HELENA_MSG_ERROR("Packet with size: {} allocate failed!", size);
+        }
+    }
+
+    inline NetworkManager::Packet::~Packet() {
+        Reset();
+    }
+
+    inline NetworkManager::Packet::Packet(const Packet& other) noexcept : m_Packet{other.m_Packet}, m_Capacity{other.m_Capacity} {
+        if(m_Packet) {
+            GetCounter(m_Packet).fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    inline NetworkManager::Packet::Packet(Packet&& other) noexcept : m_Packet{other.m_Packet}, m_Capacity{other.m_Capacity} {
+        other.m_Packet = nullptr;
+        other.m_Capacity = 0;
+    }
+
+    inline NetworkManager::Packet& NetworkManager::Packet::operator=(const Packet& other) noexcept
+    {
+        if(m_Packet != other.m_Packet)
+        {
+            Reset();
+
+            m_Packet = other.m_Packet;
+            m_Capacity = other.m_Capacity;
+            if(m_Packet) {
+                GetCounter(m_Packet).fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        return *this;
+    }
+
+    inline NetworkManager::Packet& NetworkManager::Packet::operator=(Packet&& other) noexcept
+    {
+        if(this != &other)
+        {
+            Reset();
+
+            m_Packet = other.m_Packet;
+            m_Capacity = other.m_Capacity;
+            other.m_Packet = nullptr;
+            other.m_Capacity = 0;
+        }
+
+        return *this;
+    }
+
+    [[nodiscard]] inline ENetPacket* NetworkManager::Packet::Release(EMessage type) noexcept
+    {
+        if(!Unique()) {
+            HELENA_MSG_ERROR("Packet shared with other handles and cannot be sent!");
+            return nullptr;
+        }
+
+        const auto packet = m_Packet;
+        switch(type)
+        {
+            case EMessage::None:        packet->flags = 0; break;
+            case EMessage::Reliable:    packet->flags = ENetPacketFlag::ENET_PACKET_FLAG_RELIABLE; break;
+            case EMessage::Fragmented:  packet->flags = ENetPacketFlag::ENET_PACKET_FLAG_UNRELIABLE_FRAGMENTED; break;
+            case EMessage::Unsequenced: packet->flags = ENetPacketFlag::ENET_PACKET_FLAG_UNSEQUENCED; break;
+            case EMessage::Latest:      packet->flags = 0; break;
+        }
+
+        // From now packet lifetime is managed by ENet
+        packet->referenceCount = 0;
+        m_Packet = nullptr;
+        m_Capacity = 0;
+        return packet;
+    }
+
+    [[nodiscard]] inline std::atomic_ref<std::uint32_t> NetworkManager::Packet::GetCounter(ENetPacket* packet) noexcept {
+        return std::atomic_ref<std::uint32_t>{packet->referenceCount};
+    }
+
+    [[nodiscard]] inline std::uint8_t* NetworkManager::Packet::GetData() noexcept {
+        HELENA_ASSERT(Valid(), "Packet invalid");
+        return m_Packet->data;
+    }
+
+    [[nodiscard]] inline const std::uint8_t* NetworkManager::Packet::GetData() const noexcept {
+        HELENA_ASSERT(Valid(), "Packet invalid");
+        return m_Packet->data;
+    }
+
+    [[nodiscard]] inline std::uint32_t NetworkManager::Packet::GetSize() const noexcept {
+        return m_Packet ? m_Packet->dataLength : 0;
+    }
+
+    [[nodiscard]] inline std::uint32_t NetworkManager::Packet::GetCapacity() const noexcept {
+        return m_Capacity;
+    }
+
+    inline void NetworkManager::Packet::Resize(std::uint32_t size) noexcept {
+        HELENA_ASSERT(Valid(), "Packet invalid");
+        HELENA_ASSERT(size <= m_Capacity, "Packet size: {} out of capacity: {}", size, m_Capacity);
+        m_Packet->dataLength = size;
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Packet::Unique() const noexcept {
+        return m_Packet && GetCounter(m_Packet).load(std::memory_order_acquire) == 1;
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Packet::Valid() const noexcept {
+        return m_Packet;
+    }
+
+    inline void NetworkManager::Packet::Reset() noexcept
+    {
+        if(m_Packet && GetCounter(m_Packet).fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            enet_packet_destroy(m_Packet);
+        }
+
+        m_Packet = nullptr;
+        m_Capacity = 0;
+    }
+
+
+    /* ------------ [NetworkManager::Connection] ------------ */
+    [[nodiscard]] inline std::uint8_t NetworkManager::Connection::GetSequenceID() noexcept {
+        return static_cast<Session*>(m_Peer->data)->m_Sequence;
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Connection::Validate() const noexcept {
+        return m_Peer && m_Peer->data && m_SequenceID == static_cast<const Session*>(m_Peer->data)->m_Sequence;
+    }
+
+    inline void NetworkManager::Connection::Send(EMessage type, std::uint8_t channel, const std::uint8_t* data, std::uint32_t size, std::uint32_t key) const
+    {
+        if(Valid())
+        {
+            if(m_Net->Coalesce(m_Peer, type, channel, data, size)) {
+                return;
+            }
+
+            Packet packet{size};
+            if(packet.Valid()) {
+                std::memcpy(packet.GetData(), data, size);
+                Send(type, channel, std::move(packet), key);
+            }
+        }
+    }
+
+    inline void NetworkManager::Connection::Send(EMessage type, std::uint8_t channel, Packet packet, std::uint32_t key) const
+    {
+        if(Valid() && packet.Valid())
+        {
+            const auto session = static_cast<Session*>(m_Peer->data);
+            if(session->m_State != EStateConnection::Connected) {
+                HELENA_MSG_WARNING("Packet cannot be sent now for connection!");
+                return;
+            }
+
+            if(m_Net->Coalesce(m_Peer, type, channel, packet.GetData(), packet.GetSize())) {
+                return;
+            }
+
+            if(const auto data = packet.Release(type)) {
+                if(const auto framed = m_Net->Frame(m_Peer, channel, data)) {
+                    (void)m_Net->PeerSend(m_Peer, channel, framed, type == EMessage::Latest ? key : 0);
+                }
+            }
+        }
+    }
+
+    inline void NetworkManager::Connection::Disconnect(EResetConnection flag, std::uint32_t data)
+    {
+        if(!Valid()) {
+            return;
+        }
+
+        const auto session = static_cast<Session*>(m_Peer->data);
+        if(session->m_State != EStateConnection::Disconnecting && session->m_State != EStateConnection::Disconnected) {
+            session->m_State = flag == EResetConnection::Force ? EStateConnection::Disconnected : EStateConnection::Disconnecting;
+
+            // Reset peers never get disconnect event
+            if(flag == EResetConnection::Force || flag == EResetConnection::Now) {
+                m_Net->RemoveConnection(m_Peer);
+            }
+
+            m_Net->PeerDisconnect(m_Peer, flag, data);
+        }
+    }
+
+    [[nodiscard]] inline NetworkManager::Network& NetworkManager::Connection::GetNetwork() noexcept {
+        return *m_Net;
+    }
+
+    [[nodiscard]] inline const NetworkManager::Network& NetworkManager::Connection::GetNetwork() const noexcept {
+        return *m_Net;
+    }
+
+    inline void NetworkManager::Connection::SetUserData(std::unique_ptr<NetworkManager::UserData> data) {
+        const auto session = static_cast<NetworkManager::Session*>(m_Peer->data);
+        session->m_UserData = std::move(data);
+    }
+
+    template <typename T>
+    requires std::is_base_of_v<NetworkManager::UserData, T>
+    [[nodiscard]] T* NetworkManager::Connection::GetUserData() noexcept
+    {
+        if(Valid()) {
+            const auto session = static_cast<NetworkManager::Session*>(m_Peer->data);
+            return static_cast<T*>(session->m_UserData.get());   
+        }
+
+        return nullptr;
+    }
+
+    template <typename T>
+    requires std::is_base_of_v<NetworkManager::UserData, T>
+    [[nodiscard]] const T* NetworkManager::Connection::GetUserData() const noexcept 
+    {
+        if(Valid()) {
+            const auto session = static_cast<const Session*>(m_Peer->data);
+            return static_cast<const T*>(session->m_UserData.get());
+        }
+
+        return nullptr;
+    }
+
+    [[nodiscard]] inline std::uint32_t NetworkManager::Connection::GetID() const noexcept {
+        const auto shard = static_cast<const Session*>(m_Peer->data)->m_Shard;
+        return static_cast<std::uint32_t>(shard * m_Peer->host->peerCount) + enet_peer_get_id(m_Peer);
+    }
+
+    [[nodiscard]] inline NetworkManager::EStateConnection NetworkManager::Connection::GetState() const noexcept {
+        const auto session = static_cast<Session*>(m_Peer->data);
+        return session->m_State;
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Connection::Valid() const noexcept {
+        return m_Net && m_Peer && m_Peer->data && m_SequenceID == static_cast<const Session*>(m_Peer->data)->m_Sequence;
+    }
+    
+
+    /* --------------- [NetworkManager::Group] -------------- */
+    inline NetworkManager::Group::Group(Network* net, std::uint16_t id) : m_Net{net}, m_Members{}, m_Index{}, m_Size{}, m_GroupID{id}
+    {
+        HELENA_ASSERT(net->Valid(), "Network invalid");
+        m_Members.resize(net->m_Shards.size());
+        m_Index.resize(net->m_Shards.size() * net->m_Shards.front().m_Host->peerCount);
+    }
+
+    inline bool NetworkManager::Group::Add(const Connection& connection)
+    {
+        HELENA_ASSERT(connection.m_Net == m_Net, "Connection of other network");
+        if(!connection.Valid() || connection.GetState() != EStateConnection::Connected) {
+            return false;
+        }
+
+        const auto id = connection.GetID();
+        if(!m_Index[id])
+        {
+            auto& members = m_Members[static_cast<const Session*>(connection.m_Peer->data)->m_Shard];
+            members.push_back(connection.m_Peer);
+            m_Index[id] = static_cast<std::uint32_t>(members.size());
+            m_Size++;
+        }
+
+        return true;
+    }
+
+    inline void NetworkManager::Group::Remove(const Connection& connection) noexcept {
+        if(connection.Valid() && connection.m_Net == m_Net) {
+            Remove(connection.m_Peer);
+        }
+    }
+
+    inline void NetworkManager::Group::Remove(ENetPeer* peer) noexcept
+    {
+        const auto id = Connection{m_Net, peer}.GetID();
+        if(const auto index = m_Index[id])
+        {
+            auto& members = m_Members[static_cast<const Session*>(peer->data)->m_Shard];
+            const auto last = members.back();
+            members[index - 1] = last;
+            m_Index[Connection{m_Net, last}.GetID()] = index;
+            members.pop_back();
+            m_Index[id] = 0;
+            m_Size--;
+        }
+    }
+
+    inline void NetworkManager::Group::Clear() noexcept
+    {
+        for(auto& members : m_Members) {
+            members.clear();
+        }
+
+        std::fill(m_Index.begin(), m_Index.end(), 0);
+        m_Size = 0;
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Group::Contains(const Connection& connection) const noexcept {
+        return connection.Valid() && connection.m_Net == m_Net && m_Index[connection.GetID()];
+    }
+
+    [[nodiscard]] inline std::size_t NetworkManager::Group::Size() const noexcept {
+        return m_Size;
+    }
+
+    [[nodiscard]] inline std::uint16_t NetworkManager::Group::GetID() const noexcept {
+        return m_GroupID;
+    }
+
+
+    /* ------------ [NetworkManager::Serializer] ------------ */
+    template <typename T>
+    requires requires { typename T::Schema; }
+    template <typename Field>
+    void NetworkManager::Serializer<T>::Write(const T& value, Writer& writer) noexcept
+    {
+        static_assert(std::is_same_v<typename Field::Owner, T>, "Schema field of other type");
+
+        using Value = typename Field::Value;
+        const auto& member = value.*Field::Pointer;
+
+        if constexpr(Field::FixedSize)
+        {
+            std::memcpy(writer.m_Fixed, &member, sizeof(Value));
+            if constexpr(std::endian::native == std::endian::big && std::is_scalar_v<Value>) {
+                std::reverse(writer.m_Fixed, writer.m_Fixed + sizeof(Value));
+            }
+
+            writer.m_Fixed += sizeof(Value);
+        }
+        else if constexpr(Field::BitCount)
+        {
+            constexpr auto mask = Field::BitCount == 64 ? ~0uLL : (1uLL << Field::BitCount) - 1;
+
+            auto bits = static_cast<std::uint64_t>(member) & mask;
+            for(std::uint32_t left = Field::BitCount; left;) {
+                const auto shift = writer.m_BitOffset % 8;
+                const auto count = std::min(8 - shift, left);
+                writer.m_Bits[writer.m_BitOffset / 8] |= static_cast<std::uint8_t>((bits & ((1u << count) - 1)) << shift);
+                bits >>= count;
+                left -= count;
+                writer.m_BitOffset += count;
+            }
+        }
+        else
+        {
+            using Unsigned = std::make_unsigned_t<Value>;
+
+            auto bits = static_cast<Unsigned>(member);
+            if constexpr(std::is_signed_v<Value>) {
+                bits = static_cast<Unsigned>(bits << 1) ^ static_cast<Unsigned>(member >> (sizeof(Value) * 8 - 1));
+            }
+
+            while(bits >= 0x80) {
+                *writer.m_Tail++ = static_cast<std::uint8_t>(bits | 0x80);
+                bits >>= 7;
+            }
+
+            *writer.m_Tail++ = static_cast<std::uint8_t>(bits);
+        }
+    }
+
+    template <typename T>
+    requires requires { typename T::Schema; }
+    template <typename Field>
+    [[nodiscard]] bool NetworkManager::Serializer<T>::Read(T& value, Reader& reader) noexcept
+    {
+        using Value = typename Field::Value;
+        auto& member = value.*Field::Pointer;
+
+        if constexpr(Field::FixedSize)
+        {
+            std::memcpy(&member, reader.m_Fixed, sizeof(Value));
+            if constexpr(std::endian::native == std::endian::big && std::is_scalar_v<Value>) {
+                const auto data = reinterpret_cast<std::uint8_t*>(&member);
+                std::reverse(data, data + sizeof(Value));
+            }
+
+            reader.m_Fixed += sizeof(Value);
+        }
+        else if constexpr(Field::BitCount)
+        {
+            std::uint64_t bits{};
+            for(std::uint32_t done = 0; done < Field::BitCount;) {
+                const auto shift = reader.m_BitOffset % 8;
+                const auto count = std::min(8 - shift, Field::BitCount - done);
+                bits |= static_cast<std::uint64_t>((reader.m_Bits[reader.m_BitOffset / 8] >> shift) & ((1u << count) - 1)) << done;
+                done += count;
+                reader.m_BitOffset += count;
+            }
+
+            member = static_cast<Value>(bits);
+        }
+        else
+        {
+            using Unsigned = std::make_unsigned_t<Value>;
+
+            Unsigned bits{};
+            for(std::uint32_t shift = 0;; shift += 7)
+            {
+                if(reader.m_Tail == reader.m_End || shift >= sizeof(Value) * 8) {
+                    return false;
+                }
+
+                const auto byte = *reader.m_Tail++;
+                bits |= static_cast<Unsigned>(static_cast<Unsigned>(byte & 0x7F) << shift);
+                if(!(byte & 0x80)) {
+                    break;
+                }
+            }
+
+            if constexpr(std::is_signed_v<Value>) {
+                member = static_cast<Value>(static_cast<Unsigned>(bits >> 1) ^ static_cast<Unsigned>(~(bits & 1) + 1));
+            } else {
+                member = bits;
+            }
+        }
+
+        return true;
+    }
+
+    template <typename T>
+    requires requires { typename T::Schema; }
+    template <typename Field>
+    [[nodiscard]] std::uint32_t NetworkManager::Serializer<T>::GetVarintSize(const T& value) noexcept
+    {
+        if constexpr(Field::VarintSize) {
+            using Value = typename Field::Value;
+            using Unsigned = std::make_unsigned_t<Value>;
+
+            const auto member = value.*Field::Pointer;
+            auto bits = static_cast<Unsigned>(member);
+            if constexpr(std::is_signed_v<Value>) {
+                bits = static_cast<Unsigned>(bits << 1) ^ static_cast<Unsigned>(member >> (sizeof(Value) * 8 - 1));
+            }
+
+            return (std::max<std::uint32_t>(std::bit_width(bits), 1) + 6) / 7;
+        } else {
+            return 0;
+        }
+    }
+
+    template <typename T>
+    requires requires { typename T::Schema; }
+    [[nodiscard]] std::uint32_t NetworkManager::Serializer<T>::GetSize(const T& value) noexcept {
+        return FixedSize + Apply<Layout>::GetVarintSize(value);
+    }
+
+    template <typename T>
+    requires requires { typename T::Schema; }
+    std::uint32_t NetworkManager::Serializer<T>::Write(const T& value, std::uint8_t* out) noexcept
+    {
+        Writer writer{out, out + Layout::FieldSize, out + FixedSize, 0};
+        if constexpr(Layout::BitCount != 0) {
+            std::memset(writer.m_Bits, 0, (Layout::BitCount + 7) / 8);
+        }
+
+        Apply<Layout>::Write(value, writer);
+        return static_cast<std::uint32_t>(writer.m_Tail - out);
+    }
+
+    template <typename T>
+    requires requires { typename T::Schema; }
+    [[nodiscard]] bool NetworkManager::Serializer<T>::Read(T& value, const std::uint8_t* data, std::uint32_t size) noexcept
+    {
+        if(size < FixedSize) {
+            return false;
+        }
+
+        Reader reader{data, data + Layout::FieldSize, data + FixedSize, data + size, 0};
+        return Apply<Layout>::Read(value, reader);
+    }
+
+    template <typename T>
+    requires requires { typename T::Schema; }
+    [[nodiscard]] NetworkManager::Packet NetworkManager::Serializer<T>::Encode(const T& value)
+    {
+        constexpr std::uint32_t header = requires { T::ID; } ? Router::HeaderSize : 0;
+
+        Packet packet{header + MaxSize};
+        if(packet.Valid())
+        {
+            const auto data = packet.GetData();
+            if constexpr(header != 0) {
+                data[0] = static_cast<std::uint8_t>(T::ID);
+                data[1] = static_cast<std::uint8_t>(T::ID >> 8);
+            }
+
+            packet.Resize(header + Write(value, data + header));
+        }
+
+        return packet;
+    }
+
+
+    /* -------------- [NetworkManager::Router] -------------- */
+    template <typename T, typename Func>
+    requires requires { T::ID; typename T::Schema; }
+    void NetworkManager::Router::Register(Func&& func)
+    {
+        Register(T::ID, [func = std::forward<Func>(func)](const Events::NetworkManager::Message& message) {
+            T value{};
+            if(Serializer<T>::Read(value, message.data, message.size)) {
+                func(message, value);
+            } else {
+                HELENA_MSG_WARNING("Message: {} decode failed, size: {}", T::ID, message.size);
+            }
+        });
+    }
+
+    template <std::uint16_t First, std::uint16_t Last>
+    requires (First <= Last)
+    void NetworkManager::Router::Register(Handler handler)
+    {
+        if(m_Entries.size() <= Last) {
+            m_Entries.resize(Last + 1);
+        }
+
+        for(std::uint32_t id = First; id < Last; ++id) {
+            Register(static_cast<std::uint16_t>(id), handler);
+        }
+
+        Register(Last, std::move(handler));
+    }
+
+    inline void NetworkManager::Router::Register(std::uint16_t id, Handler handler)
+    {
+        HELENA_ASSERT(id != m_Current, "Route: {} cannot be changed inside own handler", id);
+
+        if(m_Entries.size() <= id) {
+            m_Entries.resize(id + 1);
+        }
+
+        auto& entry = m_Entries[id];
+        if(!entry.m_Handler && handler) {
+            m_Routes++;
+        } else if(entry.m_Handler && !handler) {
+            m_Routes--;
+        }
+
+        entry.m_Handler = std::move(handler);
+    }
+
+    inline void NetworkManager::Router::Unregister(std::uint16_t id) {
+        if(id < m_Entries.size()) {
+            Register(id, nullptr);
+        }
+    }
+
+    [[nodiscard]] inline NetworkManager::Router::Stats NetworkManager::Router::GetStats(std::uint16_t id) const noexcept {
+        return id < m_Entries.size() ? Stats{m_Entries[id].m_Count, m_Entries[id].m_Time} : Stats{};
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Router::Empty() const noexcept {
+        return !m_Routes;
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Router::Contains(std::uint16_t id) const noexcept {
+        return id < m_Entries.size() && m_Entries[id].m_Handler;
+    }
+
+    inline void NetworkManager::Router::Route(std::uint16_t id, const Events::NetworkManager::Message& message)
+    {
+        const auto timeStart = Worker::GetTime();
+        m_Current = id;
+        m_Entries[id].m_Handler(message);
+        m_Current = None;
+
+        // Handler can register other ids, growing the deque keeps the running entry in place
+        auto& entry = m_Entries[id];
+        entry.m_Count++;
+        entry.m_Time += static_cast<std::uint64_t>(Worker::GetTime() - timeStart);
+    }
+
+
+    /* -------------- [NetworkManager::Network] ------------- */
+    inline NetworkManager::Network::Network(std::uint16_t id) : m_Shards{}, m_Connections{}, m_Coalesced{}, m_Groups{}, m_Router{}, m_Compressor{}, m_CompressionStats{}, m_Handshakes{}, m_UserData{}, m_CipherKey{}, m_CipherKeyID{}, m_NetworkID{id}
+        , m_GroupSequenceID{}, m_Budget{}, m_EventCost{1000}, m_EventsProcessed{}, m_EventsDeferred{}, m_MessagesCoalesced{}, m_PacketsCoalesced{}
+        , m_CookieSampleTime{}, m_CookieSampleRejects{}, m_CookieRejectRate{}
+        , m_Compression{}, m_Coalesce{}, m_CoalesceChannel{}, m_Server{}, m_RetainPackets{}, m_Cookies{}, m_Encryption{}, m_Initialized{}
+    {
+        Allocator::Install();
+        if(!enet_initialize()) {
+            m_Initialized = true;
+        } else {
+            HELENA_ASSERT(m_Initialized, "WinSock init failed");
+            Helena::Engine::Shutdown("Initialize network failed");
+        }
+    }
+
+    inline NetworkManager::Network::~Network() 
+    {
+        Shutdown();
+        if(m_Initialized) {
+            enet_deinitialize();
+        }
+    }
+
+    inline NetworkManager::Network::Network(Network&& other) noexcept {
+        m_Shards = std::move(other.m_Shards);
+        m_Connections = std::move(other.m_Connections);
+        m_Coalesced = std::move(other.m_Coalesced);
+        m_Groups = std::move(other.m_Groups);
+        m_Router = std::move(other.m_Router);
+        m_Compressor = std::move(other.m_Compressor);
+        m_CompressionStats = std::move(other.m_CompressionStats);
+        m_Handshakes = std::move(other.m_Handshakes);
+        m_UserData = std::move(other.m_UserData);
+        m_CipherKey = other.m_CipherKey;
+        m_CipherKeyID = other.m_CipherKeyID;
+        m_NetworkID = other.m_NetworkID;
+        m_GroupSequenceID = other.m_GroupSequenceID;
+        m_Budget = other.m_Budget;
+        m_EventCost = other.m_EventCost;
+        m_EventsProcessed = other.m_EventsProcessed;
+        m_EventsDeferred = other.m_EventsDeferred;
+        m_MessagesCoalesced = other.m_MessagesCoalesced;
+        m_PacketsCoalesced = other.m_PacketsCoalesced;
+        m_CookieSampleTime = other.m_CookieSampleTime;
+        m_CookieSampleRejects = other.m_CookieSampleRejects;
+        m_CookieRejectRate = other.m_CookieRejectRate;
+        m_Compression = other.m_Compression;
+        m_Coalesce = other.m_Coalesce;
+        m_CoalesceChannel = other.m_CoalesceChannel;
+        m_Initialized = other.m_Initialized;
+        m_Server = other.m_Server;
+        m_RetainPackets = other.m_RetainPackets;
+        m_Cookies = other.m_Cookies;
+        m_Encryption = other.m_Encryption;
+
+        for(auto& group : m_Groups) {
+            group.m_Net = this;
+        }
+
+        other.m_Shards.clear();
+    }
+
+    inline NetworkManager::Network& NetworkManager::Network::operator=(Network&& other) noexcept {
+        m_Shards = std::move(other.m_Shards);
+        m_Connections = std::move(other.m_Connections);
+        m_Coalesced = std::move(other.m_Coalesced);
+        m_Groups = std::move(other.m_Groups);
+        m_Router = std::move(other.m_Router);
+        m_Compressor = std::move(other.m_Compressor);
+        m_CompressionStats = std::move(other.m_CompressionStats);
+        m_Handshakes = std::move(other.m_Handshakes);
+        m_UserData = std::move(other.m_UserData);
+        m_CipherKey = other.m_CipherKey;
+        m_CipherKeyID = other.m_CipherKeyID;
+        m_NetworkID = other.m_NetworkID;
+        m_GroupSequenceID = other.m_GroupSequenceID;
+        m_Budget = other.m_Budget;
+        m_EventCost = other.m_EventCost;
+        m_EventsProcessed = other.m_EventsProcessed;
+        m_EventsDeferred = other.m_EventsDeferred;
+        m_MessagesCoalesced = other.m_MessagesCoalesced;
+        m_PacketsCoalesced = other.m_PacketsCoalesced;
+        m_CookieSampleTime = other.m_CookieSampleTime;
+        m_CookieSampleRejects = other.m_CookieSampleRejects;
+        m_CookieRejectRate = other.m_CookieRejectRate;
+        m_Compression = other.m_Compression;
+        m_Coalesce = other.m_Coalesce;
+        m_CoalesceChannel = other.m_CoalesceChannel;
+        m_Initialized = other.m_Initialized;
+        m_Server = other.m_Server;
+        m_RetainPackets = other.m_RetainPackets;
+        m_Cookies = other.m_Cookies;
+        m_Encryption = other.m_Encryption;
+
+        for(auto& group : m_Groups) {
+            group.m_Net = this;
+        }
+
+        other.m_Shards.clear();
+        return *this;
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Network::CreateServer(const Config& config) 
+    {
+        if(!m_Initialized) {
+            return false;
+        }
+
+        if(!m_Shards.empty()) {
+            HELENA_MSG_ERROR("Create server with ip: {}, port: {} failed: current network already used!",
+                config.GetIP(), config.GetPort());
+            return false;
+        }
+
+        const std::size_t shards = std::max<std::size_t>(config.GetShards(), 1);
+        if((config.GetPeers() + shards - 1) / shards > ENET_PROTOCOL_MAXIMUM_PEER_ID) {
+            HELENA_MSG_ERROR("Create server with peers: {} failed: {} shards hold up to {} peers!",
+                config.GetPeers(), shards, shards * ENET_PROTOCOL_MAXIMUM_PEER_ID);
+            return false;
+        }
+
+        m_Server = true;
+        m_RetainPackets = config.GetRetainPackets();
+        m_Budget = config.GetBudget();
+        m_Coalesce = GetChannelCount(config) > config.GetChannels() ? config.GetCoalesce() : 0;
+        m_CoalesceChannel = config.GetChannels();
+        m_Compression = config.GetCompression();
+        m_Compressor = m_Compression ? std::make_unique<Compressor>(config.GetDictionary()) : nullptr;
+        m_CompressionStats.assign(GetChannelCount(config), CompressionStats{});
+        m_Cookies = config.GetCookies();
+        m_Encryption = config.GetEncryption();
+        m_CipherKey = config.GetEncryptionKey();
+        m_CipherKeyID = m_Encryption ? Cipher::GetKeyID(m_CipherKey) : 0;
+        m_CookieSampleTime = 0;
+        m_CookieRejectRate = 0;
+
+        // One cookie key for all shards
+        std::random_device random;
+        const std::uint64_t cookieKey[2]{
+            static_cast<std::uint64_t>(random()) << 32 | random(),
+            static_cast<std::uint64_t>(random()) << 32 | random()
+        };
+
+        for(std::size_t shard = 0; shard < shards; ++shard)
+        {
+            const auto host = CreateHost(config, m_Server, static_cast<std::uint8_t>(shard));
+            if(!host) {
+                Shutdown();
+                return false;
+            }
+
+            if(m_Cookies) {
+                enet_host_set_cookies(host, cookieKey[0], cookieKey[1]);
+            }
+
+            auto& [shardHost, shardWorker, shardWatched] = m_Shards.emplace_back(host, nullptr);
+            if(config.GetThreaded()) {
+                shardWorker = std::make_unique<Worker>(config.GetQueueSize());
+                shardWorker->Start(shardHost);
+            }
+        }
+
+        m_Handshakes.Resize(m_Shards.size() * m_Shards.front().m_Host->peerCount);
+        return true;
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Network::CreateClient(const Config& config) 
+    {
+        if(!m_Initialized) {
+            return false;
+        }
+
+        if(!m_Shards.empty() && m_Server) {
+            HELENA_MSG_ERROR("Client connection cannot be created inside server network!");
+            return false;
+        }
+        
+        if(m_Shards.empty()) {
+            m_Server = false;
+            m_RetainPackets = config.GetRetainPackets();
+            m_Budget = config.GetBudget();
+            m_Coalesce = GetChannelCount(config) > config.GetChannels() ? config.GetCoalesce() : 0;
+            m_CoalesceChannel = config.GetChannels();
+            m_Compression = config.GetCompression();
+            m_Compressor = m_Compression ? std::make_unique<Compressor>(config.GetDictionary()) : nullptr;
+            m_CompressionStats.assign(GetChannelCount(config), CompressionStats{});
+            m_Cookies = config.GetCookies();
+            m_Encryption = config.GetEncryption();
+            m_CipherKey = config.GetEncryptionKey();
+            m_CipherKeyID = m_Encryption ? Cipher::GetKeyID(m_CipherKey) : 0;
+            if(const auto host = CreateHost(config, m_Server)) {
+                if(m_Cookies) {
+                    std::random_device random;
+                    enet_host_set_cookies(host, static_cast<std::uint64_t>(random()) << 32 | random(),
+                        static_cast<std::uint64_t>(random()) << 32 | random());
+                }
+
+                m_Shards.emplace_back(host, nullptr);
+            }
+        }
+
+        if(!m_Shards.empty())
+        {
+            auto& [host, worker, watched] = m_Shards.front();
+
+            ENetAddress address{};
+            if(CreateAddress(address, config.GetIP(), config.GetPort()))
+            {
+                if(worker) {
+                    Outbound command{};
+                    command.type = ECommand::Connect;
+                    command.address = address;
+                    command.channel = GetChannelCount(config);
+                    command.data = config.GetData();
+                    worker->Post(command);
+                    return true;
+                }
+
+                if(const auto peer = enet_host_connect(host, &address, GetChannelCount(config), config.GetData())) 
+                {
+                    const auto session = static_cast<Session*>(peer->data);
+                    session->m_State = EStateConnection::Connecting;
+                    session->m_Sequence++;
+                    session->m_UserData.reset();
+                    session->m_HandshakeKey = 0;
+                    session->m_Capabilities = 0;
+                    session->m_Cipher = {};
+                    session->m_ConnectID = peer->connectID;
+
+                    if(config.GetThreaded()) {
+                        worker = std::make_unique<Worker>(config.GetQueueSize());
+                        worker->Start(host);
+                    }
+
+                    return true;
+                } else {
+                    HELENA_MSG_ERROR("Connect to server ip: {}, port: {} failed!", config.GetIP(), config.GetPort());
+                }
+            }
+        }
+
+        return false;
+    }
+
+    inline void NetworkManager::Network::Shutdown() 
+    {
+        if(Valid()) 
+        {
+            for(const auto peer : m_Coalesced) {
+                DropCoalesced(peer);
+            }
+
+            for(auto& [host, worker, watched] : m_Shards)
+            {
+                if(worker) {
+                    worker->Stop();
+                    worker.reset();
+                }
+
+                const auto peer = host->peers;
+                delete[] static_cast<Session*>(peer->data);
+
+                enet_host_flush(host);
+                enet_host_destroy(host);
+            }
+
+            m_Shards.clear();
+            m_Connections.clear();
+            m_Coalesced.clear();
+            m_Groups.clear();
+            m_Handshakes.Clear();
+        }
+    }
+
+    inline void NetworkManager::Network::Broadcast(EMessage type, std::uint8_t channel, const std::uint8_t* data, std::uint32_t size) const
+    {
+        if(Valid())
+        {
+            Packet packet{size};
+            if(packet.Valid()) {
+                std::memcpy(packet.GetData(), data, size);
+                Broadcast(type, channel, std::move(packet));
+            }
+        }
+    }
+
+    inline void NetworkManager::Network::Broadcast(EMessage type, std::uint8_t channel, Packet packet) const
+    {
+        if(Valid() && packet.Valid()) {
+            if(const auto data = packet.Release(type))
+            {
+                // Hold the packet while shards are walked, enet_host_broadcast destroys unreferenced packet
+                data->referenceCount++;
+
+                // Peers with compression or encryption expect framed payload, connected peers are split by shard
+                if(m_Compressor || m_Encryption)
+                {
+                    std::vector<std::vector<ENetPeer*>> peers(m_Shards.size());
+                    for(const auto peer : m_Connections) {
+                        peers[static_cast<const Session*>(peer->data)->m_Shard].push_back(peer);
+                    }
+
+                    Multicast(channel, data, peers);
+                    if(!--data->referenceCount) {
+                        enet_packet_destroy(data);
+                    }
+                    return;
+                }
+
+                for(const auto& [host, worker, watched] : m_Shards)
+                {
+                    if(worker) {
+                        // I/O threads change referenceCount without sync, each shard gets own copy
+                        Outbound command{};
+                        command.type = ECommand::Broadcast;
+                        command.packet = enet_packet_create(data->data, data->dataLength, data->flags);
+                        command.channel = channel;
+                        if(command.packet) {
+                            worker->Post(command);
+                        }
+                        continue;
+                    }
+
+                    enet_host_broadcast(host, channel, data);
+                }
+
+                if(!--data->referenceCount) {
+                    enet_packet_destroy(data);
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] inline NetworkManager::Group& NetworkManager::Network::CreateGroup() {
+        HELENA_ASSERT(Valid(), "Network invalid");
+        return m_Groups.emplace_back(this, m_GroupSequenceID++);
+    }
+
+    inline void NetworkManager::Network::RemoveGroup(std::uint16_t id) noexcept
+    {
+        const auto it = std::find_if(m_Groups.cbegin(), m_Groups.cend(), [id](const auto& group) {
+            return group.GetID() == id;
+        });
+
+        if(it != m_Groups.cend()) {
+            m_Groups.erase(it);
+        }
+    }
+
+    [[nodiscard]] inline NetworkManager::Group* NetworkManager::Network::GetGroup(std::uint16_t id) noexcept {
+        const auto it = std::find_if(m_Groups.begin(), m_Groups.end(), [id](const auto& group) {
+            return group.GetID() == id;
+        });
+
+        return it == m_Groups.cend() ? nullptr : &(*it);
+    }
+
+    [[nodiscard]] inline const NetworkManager::Group* NetworkManager::Network::GetGroup(std::uint16_t id) const noexcept {
+        const auto it = std::find_if(m_Groups.cbegin(), m_Groups.cend(), [id](const auto& group) {
+            return group.GetID() == id;
+        });
+
+        return it == m_Groups.cend() ? nullptr : &(*it);
+    }
+
+    inline void NetworkManager::Network::SendGroup(const Group& group, EMessage type, std::uint8_t channel, const std::uint8_t* data, std::uint32_t size) const
+    {
+        if(Valid() && group.Size())
+        {
+            Packet packet{size};
+            if(packet.Valid()) {
+                std::memcpy(packet.GetData(), data, size);
+                SendGroup(group, type, channel, std::move(packet));
+            }
+        }
+    }
+
+    inline void NetworkManager::Network::SendGroup(const Group& group, EMessage type, std::uint8_t channel, Packet packet) const
+    {
+        HELENA_ASSERT(group.m_Net == this, "Group of other network");
+
+        if(Valid() && packet.Valid() && group.Size()) {
+            if(const auto data = packet.Release(type))
+            {
+                // Hold the packet while shards are walked, enet_host_broadcast_selective destroys unreferenced packet
+                data->referenceCount++;
+                Multicast(channel, data, group.m_Members);
+                if(!--data->referenceCount) {
+                    enet_packet_destroy(data);
+                }
+            }
+        }
+    }
+
+    [[nodiscard]] inline std::uint16_t NetworkManager::Network::GetID() const noexcept {
+        return m_NetworkID;
+    }
+
+    [[nodiscard]] inline NetworkManager::Router& NetworkManager::Network::GetRouter() noexcept {
+        return m_Router;
+    }
+
+    [[nodiscard]] inline const NetworkManager::Router& NetworkManager::Network::GetRouter() const noexcept {
+        return m_Router;
+    }
+
+    [[nodiscard]] inline NetworkManager::CompressionStats NetworkManager::Network::GetCompressionStats(std::uint8_t channel) const noexcept {
+        return channel < m_CompressionStats.size() ? m_CompressionStats[channel] : CompressionStats{};
+    }
+
+    [[nodiscard]] inline NetworkManager::QueueDelayStats NetworkManager::Network::GetQueueDelay(std::uint8_t channel) const noexcept
+    {
+        QueueDelayStats stats{};
+        for(const auto& [host, worker, watched] : m_Shards)
+        {
+            const auto delay = worker ? nullptr : enet_host_get_queue_delay(host, channel);
+            for(std::size_t bucket = 0; bucket < ENET_HOST_QUEUE_DELAY_BUCKETS; ++bucket) 
+            {
+                std::uint64_t count{};
+                if(worker) {
+                    const auto index = channel * std::size_t{ENET_HOST_QUEUE_DELAY_BUCKETS} + bucket;
+                    count = index < worker->m_QueueDelay.size() ? worker->m_QueueDelay[index].load(std::memory_order_relaxed) : 0;
+                } else if(delay) {
+                    count = delay[bucket];
+                }
+
+                stats.buckets[bucket] += count;
+                stats.count += count;
+            }
+        }
+
+        return stats;
+    }
+
+    [[nodiscard]] inline NetworkManager::Statistics NetworkManager::Network::GetStatistics() const noexcept
+    {
+        HELENA_ASSERT(Valid(), "Network invalid");
+
+        Statistics stats{};
+        for(const auto& [host, worker, watched] : m_Shards)
+        {
+            if(worker) {
+                stats.receivedPackets += worker->m_ReceivedPackets.load(std::memory_order_relaxed);
+                stats.receiveCalls += worker->m_ReceiveCalls.load(std::memory_order_relaxed);
+                stats.sentPackets += worker->m_SentPackets.load(std::memory_order_relaxed);
+                stats.sendCalls += worker->m_SendCalls.load(std::memory_order_relaxed);
+                stats.replacedCommands += worker->m_ReplacedCommands.load(std::memory_order_relaxed);
+                stats.cookieReplies += worker->m_CookieReplies.load(std::memory_order_relaxed);
+                stats.connectsRejected += worker->m_CookieRejects.load(std::memory_order_relaxed);
+                stats.cookieTime += worker->m_CookieTime.load(std::memory_order_relaxed);
+                stats.datagramsLimited += worker->m_LimitedPackets.load(std::memory_order_relaxed);
+                stats.bytesLimited += worker->m_LimitedBytes.load(std::memory_order_relaxed);
+                stats.inboundDepth += worker->m_Inbound.Size();
+                stats.inboundPeak = std::max(stats.inboundPeak, worker->m_Inbound.Peak());
+                stats.outboundDepth += worker->m_Outbound.Size();
+                stats.outboundPeak = std::max(stats.outboundPeak, worker->m_Outbound.Peak());
+                stats.latencyCount += worker->m_LatencyCount;
+                stats.latencyTotal += worker->m_LatencyTotal;
+                stats.latencyMax = std::max(stats.latencyMax, worker->m_LatencyMax);
+            } else {
+                stats.receivedPackets += enet_host_get_packets_received(host);
+                stats.receiveCalls += enet_host_get_receive_calls(host);
+                stats.sentPackets += enet_host_get_packets_sent(host);
+                stats.sendCalls += enet_host_get_send_calls(host);
+                stats.replacedCommands += enet_host_get_replaced_commands(host);
+                stats.cookieReplies += enet_host_get_cookie_replies(host);
+                stats.connectsRejected += enet_host_get_cookie_rejects(host);
+                stats.cookieTime += enet_host_get_cookie_time(host);
+                stats.datagramsLimited += enet_host_get_limited_packets(host);
+                stats.bytesLimited += enet_host_get_limited_bytes(host);
+            }
+        }
+
+        stats.handshakesPending = m_Handshakes.Pending();
+        stats.handshakesExpired = m_Handshakes.Expired();
+        stats.eventsProcessed = m_EventsProcessed;
+        stats.eventsDeferred = m_EventsDeferred;
+        stats.eventCost = m_EventCost;
+        stats.messagesCoalesced = m_MessagesCoalesced;
+        stats.packetsCoalesced = m_PacketsCoalesced;
+        stats.connectsRejectedRate = m_CookieRejectRate;
+
+        stats.sendCallsSaved = stats.sentPackets > stats.sendCalls ? stats.sentPackets - stats.sendCalls : 0;
+        return stats;
+    }
+
+    inline void NetworkManager::Network::SetUserData(std::unique_ptr<NetworkManager::UserData> data) {
+        m_UserData = std::move(data);
+    }
+
+    template <typename T>
+    requires std::is_base_of_v<NetworkManager::UserData, T>
+    [[nodiscard]] T* NetworkManager::Network::GetUserData() noexcept {
+        return static_cast<T*>(m_UserData.get());
+    }
+
+    template <typename T>
+    requires std::is_base_of_v<NetworkManager::UserData, T>
+    [[nodiscard]] const T* NetworkManager::Network::GetUserData() const noexcept {
+        return static_cast<const T*>(m_UserData.get());
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Network::Server() const noexcept {
+        HELENA_ASSERT(Valid(), "Network invalid");
+        return m_Server;
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Network::Valid() const noexcept {
+        return m_Initialized && !m_Shards.empty();
+    }
+
+    template <typename Func>
+    void NetworkManager::Network::Each(Func&& func) 
+    {
+        HELENA_ASSERT(Valid(), "Network invalid");
+
+        // Backward walk, disconnect inside func moves an already visited connection into the slot
+        for(auto index = m_Connections.size(); index--;) {
+            func(NetworkManager::Connection{this, m_Connections[index]});
+        }
+    }
+
+    template <typename Func>
+    void NetworkManager::Network::Each(Func&& func) const 
+    {
+        HELENA_ASSERT(Valid(), "Network invalid");
+        for(auto index = m_Connections.size(); index--;) {
+            func(NetworkManager::Connection{this, m_Connections[index]});
+        }
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Network::CreateAddress(ENetAddress& address, const std::string_view ip, std::uint16_t port)
+    {
+        address.port = port;
+        if(enet_address_set_ip(&address, ip.data())) {
+            HELENA_MSG_ERROR("Create address with ip: {}, port: {} failed!", ip, port);
+            return false;
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] inline ENetHost* NetworkManager::Network::CreateHost(const Config& config, bool server, std::uint8_t shard)
+    {
+        ENetHost* host{};
+
+        if(server) {
+            const std::size_t shards = std::max<std::size_t>(config.GetShards(), 1);
+            const std::size_t peers = (config.GetPeers() + shards - 1) / shards;
+
+            ENetAddress address{};
+            if(CreateAddress(address, config.GetIP(), config.GetPort())) {
+                host = enet_host_create(&address, peers, GetChannelCount(config),
+                    config.GetBandwidthIn(), config.GetBandwidthOut(), config.GetBufferSize(), shards > 1);
+            }
+        } else {
+            host = enet_host_create(nullptr, config.GetPeers(), 1,
+                config.GetBandwidthIn(), config.GetBandwidthOut(), config.GetBufferSize());
+        }
+
+        if(host)
+        {
+            if(config.GetReceiveBatch() > 1 && enet_host_set_receive_batch(host, config.GetReceiveBatch())) {
+                HELENA_MSG_WARNING("Receive batch: {} not supported, fallback to single receive!", config.GetReceiveBatch());
+            }
+
+            if(config.GetSendBatch() > 1 && enet_host_set_send_batch(host, config.GetSendBatch())) {
+                HELENA_MSG_WARNING("Send batch: {} not supported, fallback to single send!", config.GetSendBatch());
+            }
+
+            if(config.GetChecksum()) {
+                enet_host_set_checksum_callback(host, enet_crc32c);
+            }
+
+            if(config.GetCongestion() == ECongestion::Delay) {
+                enet_host_set_congestion_control(host, enet_congestion_delay());
+            }
+
+            // Timer pacing needs the host woken at departure times, Tick services it once per tick and held data would leave in one burst
+            auto pacing = config.GetPacing();
+            if(pacing == EPacing::Timer && !config.GetThreaded()) {
+                HELENA_MSG_WARNING("Pacing: timer pacing needs threaded mode, fallback to SO_TXTIME pacing!");
+                pacing = EPacing::TxTime;
+            }
+
+            if(pacing == EPacing::TxTime && enet_host_set_pacing(host, ENET_PACING_TXTIME)) {
+                if(config.GetThreaded()) {
+                    HELENA_MSG_WARNING("Pacing: SO_TXTIME not supported, fallback to timer pacing!");
+                    enet_host_set_pacing(host, ENET_PACING_TIMER);
+                } else {
+                    HELENA_MSG_WARNING("Pacing: SO_TXTIME not supported and timer pacing needs threaded mode, pacing disabled!");
+                }
+            } else if(pacing == EPacing::Timer) {
+                enet_host_set_pacing(host, ENET_PACING_TIMER);
+            }
+
+            // Keyed table index, addresses cannot be chosen to collide
+            if(config.GetRateLimit()) {
+                std::random_device random;
+                if(enet_host_set_rate_limit(host, config.GetRateLimit(), config.GetRateBurst(), host->peerCount * 4,
+                    static_cast<std::uint64_t>(random()) << 32 | random(), static_cast<std::uint64_t>(random()) << 32 | random())) {
+                    HELENA_MSG_WARNING("Rate limit: {} not supported, limiter disabled!", config.GetRateLimit());
+                }
+            }
+
+            // Internal coalesce channel is scheduled with defaults
+            if(!config.GetChannelSchedule().empty()) {
+                auto schedule = config.GetChannelSchedule();
+                schedule.resize(std::max<std::size_t>(GetChannelCount(config), schedule.size()), ENetChannelSchedule{0, 1});
+                if(enet_host_set_channel_schedule(host, schedule.data(), schedule.size())) {
+                    HELENA_MSG_WARNING("Channel schedule not supported, outgoing commands stay in FIFO order!");
+                }
+            }
+
+            Session* sessions = new Session[host->peerCount]{};
+            for(auto currentPeer = host->peers; currentPeer < &host->peers[host->peerCount]; ++currentPeer) {
+                sessions->m_Shard = shard;
+                currentPeer->data = sessions++;
+            }
+        } else {
+            HELENA_MSG_ERROR("Create host with ip: {}, port: {}, peers: {}, channels: {} failed!",
+                config.GetIP(), config.GetPort(), config.GetPeers(), config.GetChannels());
+        }
+        return host;
+    }
+
+    [[nodiscard]] inline std::uint8_t NetworkManager::Network::GetChannelCount(const Config& config) noexcept
+    {
+        // Coalesced aggregates travel on one more channel after the user channels
+        if(config.GetCoalesce() && config.GetChannels() < ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT) {
+            return config.GetChannels() + 1;
+        }
+
+        if(config.GetCoalesce()) {
+            HELENA_MSG_WARNING("Coalesce disabled: channels: {} leave no room for internal channel!", config.GetChannels());
+        }
+
+        return config.GetChannels();
+    }
+
+    [[nodiscard]] inline std::int64_t NetworkManager::Network::Scramble(std::int64_t value) noexcept {
+        std::int64_t out = value ^ 0xDEADBEEFC0DECAFE;
+        //out = (out & 0xF0F0F0F0F0F0F0) >> 4 | (out & 0x0F0F0F0F0F0F0F) << 4;
+        return out ^ 0xC0DEFACE12345678;
+    }
+
+    inline bool NetworkManager::Network::SendHandshake(ENetPeer* peer, std::int64_t key) const
+    {
+        // Capabilities follow the key only when there is something to negotiate
+        const auto crypt    = Scramble(key);
+        const auto hash     = m_Compressor ? m_Compressor->GetHash() : 0;
+        const auto size     = m_Compressor || m_Encryption ? HandshakeSize : sizeof(std::int64_t);
+        const auto session  = static_cast<const Session*>(peer->data);
+
+        std::array<std::uint8_t, HandshakeSize> data{};
+        std::memcpy(data.data(), &crypt, sizeof(std::int64_t));
+        data[sizeof(std::int64_t)] = (m_Compressor ? CapabilityCompression : 0) | (m_Encryption ? CapabilityEncryption : 0);
+        for(std::size_t index = 0; index < sizeof(std::uint32_t); ++index) {
+            data[sizeof(std::int64_t) + 1 + index] = static_cast<std::uint8_t>(hash >> index * 8);
+            data[sizeof(std::int64_t) + 5 + index] = static_cast<std::uint8_t>(m_CipherKeyID >> index * 8);
+        }
+
+        // Own nonce, server half of the salt on server
+        std::memcpy(data.data() + HandshakeSize - HandshakeNonceSize, session->m_Cipher.m_Salt.data() + (m_Server ? 0 : HandshakeNonceSize), HandshakeNonceSize);
+
+        const auto packet   = enet_packet_create(data.data(), size, ENetPacketFlag::ENET_PACKET_FLAG_RELIABLE);
+        if(!packet || !PeerSend(peer, 0, packet)) {
+            PeerReset(peer);
+            return false;
+        }
+
+        return true;
+    }
+
+    [[nodiscard]] inline std::uint8_t NetworkManager::Network::Negotiate(const std::uint8_t* data) const noexcept
+    {
+        const auto remote = data[sizeof(std::int64_t)];
+        std::uint32_t hash{};
+        std::uint32_t keyID{};
+        for(std::size_t index = 0; index < sizeof(std::uint32_t); ++index) {
+            hash |= static_cast<std::uint32_t>(data[sizeof(std::int64_t) + 1 + index]) << index * 8;
+            keyID |= static_cast<std::uint32_t>(data[sizeof(std::int64_t) + 5 + index]) << index * 8;
+        }
+
+        auto capabilities = static_cast<std::uint8_t>(((m_Compressor ? CapabilityCompression : 0) | (m_Encryption ? CapabilityEncryption : 0)) & remote);
+        if(capabilities & CapabilityCompression && hash != m_Compressor->GetHash()) {
+            HELENA_MSG_WARNING("Compression disabled for connection: dictionary mismatch!");
+            capabilities &= ~CapabilityCompression;
+        }
+
+        if(capabilities & CapabilityEncryption && keyID != m_CipherKeyID) {
+            HELENA_MSG_WARNING("Encryption disabled for connection: key mismatch!");
+            capabilities &= ~CapabilityEncryption;
+        }
+
+        return capabilities;
+    }
+
+    [[nodiscard]] inline std::uint64_t NetworkManager::Network::GetHandshakeSalt(const ENetPeer* peer) const noexcept {
+        // Both sides salt with the peer id assigned by the server host
+        return (m_Server ? peer->incomingPeerID : peer->outgoingPeerID) + 1uLL;
+    }
+
+    inline void NetworkManager::Network::SetupCipher(ENetPeer* peer) const
+    {
+        const auto session = static_cast<Session*>(peer->data);
+        auto& cipher = session->m_Cipher;
+        if(!(session->m_Capabilities & CapabilityEncryption)) {
+            return;
+        }
+
+        // Both nonces are mixed into the master key, session keys are bound to this connection and direction
+        const auto master = Cipher::Derive(Cipher::Derive(m_CipherKey, cipher.m_Salt.data()), cipher.m_Salt.data() + HandshakeNonceSize);
+
+        std::array<std::uint8_t, 16> input{};
+        std::memcpy(input.data(), &session->m_ConnectID, sizeof(std::uint32_t));
+
+        input[12] = 'c'; input[13] = '2'; input[14] = 's';
+        const auto clientKey = Cipher::Derive(master, input.data());
+        input[12] = 's'; input[14] = 'c';
+        const auto serverKey = Cipher::Derive(master, input.data());
+
+        cipher.m_SendKey = m_Server ? serverKey : clientKey;
+        cipher.m_ReceiveKey = m_Server ? clientKey : serverKey;
+        cipher.m_SendSequence = 0;
+        cipher.m_ReceiveSequence = 0;
+        cipher.m_Window.fill(0);
+        cipher.m_SendOrdered.assign(peer->channelCount, 0);
+        cipher.m_ReceiveOrdered.assign(peer->channelCount, 0);
+    }
+
+    [[nodiscard]] inline NetworkManager::Worker* NetworkManager::Network::GetWorker(const ENetPeer* peer) const noexcept {
+        return m_Shards[static_cast<const Session*>(peer->data)->m_Shard].m_Worker.get();
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Network::PeerSend(ENetPeer* peer, std::uint8_t channel, ENetPacket* packet, std::uint32_t key) const
+    {
+        if(const auto worker = GetWorker(peer)) {
+            Outbound command{};
+            command.type = ECommand::Send;
+            command.peer = peer;
+            command.packet = packet;
+            command.connectID = static_cast<const Session*>(peer->data)->m_ConnectID;
+            command.data = key;
+            command.channel = channel;
+            worker->Post(command);
+            return true;
+        }
+
+        if(enet_peer_send_latest(peer, channel, packet, key)) {
+            if(!packet->referenceCount) {
+                enet_packet_destroy(packet);
+            }
+            return false;
+        }
+
+        return true;
+    }
+
+    inline void NetworkManager::Network::PeerDisconnect(ENetPeer* peer, EResetConnection flag, std::uint32_t data) const
+    {
+        if(const auto worker = GetWorker(peer))
+        {
+            Outbound command{};
+            switch(flag)
+            {
+                case EResetConnection::Default: command.type = ECommand::DisconnectLater; break;
+                case EResetConnection::Update:  command.type = ECommand::Disconnect; break;
+                case EResetConnection::Force:   command.type = ECommand::Reset; break;
+                case EResetConnection::Now:     command.type = ECommand::DisconnectNow; break;
+            }
+
+            command.peer = peer;
+            command.connectID = static_cast<const Session*>(peer->data)->m_ConnectID;
+            command.data = data;
+            worker->Post(command);
+            return;
+        }
+
+        switch(flag)
+        {
+            case EResetConnection::Default: enet_peer_disconnect_later(peer, data); break;
+            case EResetConnection::Update:  enet_peer_disconnect(peer, data); break;
+            case EResetConnection::Force:   enet_peer_reset(peer); break;
+            case EResetConnection::Now:     enet_peer_disconnect_now(peer, data); break;
+        }
+    }
+
+    inline void NetworkManager::Network::PeerReset(ENetPeer* peer) const {
+        PeerDisconnect(peer, EResetConnection::Force, 0);
+    }
+
+    inline void NetworkManager::Network::AddHandshake(ENetPeer* peer, std::uint32_t timeout) {
+        m_Handshakes.Add(Connection{this, peer}.GetID(), peer, enet_time_get() + timeout);
+    }
+
+    inline void NetworkManager::Network::RemoveHandshake(ENetPeer* peer) {
+        m_Handshakes.Remove(Connection{this, peer}.GetID());
+    }
+
+    inline void NetworkManager::Network::AddConnection(ENetPeer* peer)
+    {
+        const auto session = static_cast<Session*>(peer->data);
+        if(!session->m_Index) {
+            m_Connections.push_back(peer);
+            session->m_Index = static_cast<std::uint32_t>(m_Connections.size());
+        }
+    }
+
+    inline void NetworkManager::Network::RemoveConnection(ENetPeer* peer)
+    {
+        const auto session = static_cast<Session*>(peer->data);
+        if(session->m_Index)
+        {
+            const auto last = m_Connections.back();
+            m_Connections[session->m_Index - 1] = last;
+            static_cast<Session*>(last->data)->m_Index = session->m_Index;
+            m_Connections.pop_back();
+            session->m_Index = 0;
+        }
+
+        for(auto& group : m_Groups) {
+            group.Remove(peer);
+        }
+
+        DropCoalesced(peer);
+    }
+
+    [[nodiscard]] inline bool NetworkManager::Network::Coalesce(ENetPeer* peer, EMessage type, std::uint8_t channel, const std::uint8_t* data, std::uint32_t size)
+    {
+        if(!m_Coalesce || (type != EMessage::None && type != EMessage::Unsequenced) || size + CoalesceHeader > m_Coalesce) {
+            return false;
+        }
+
+        // Peer without internal channel has not enabled coalescing
+        if(channel >= m_CoalesceChannel || peer->channelCount <= m_CoalesceChannel) {
+            return false;
+        }
+
+        const auto session = static_cast<Session*>(peer->data);
+        if(session->m_State != EStateConnection::Connected) {
+            return false;
+        }
+
+        // Aggregate has one delivery type, full or other type aggregate leaves now
+        if(session->m_Coalesce && (session->m_CoalesceType != type || session->m_CoalesceSize + CoalesceHeader + size > m_Coalesce)) {
+            FlushCoalesced(peer);
+        }
+
+        if(!session->m_Coalesce)
+        {
+            session->m_Coalesce = enet_packet_create(nullptr, m_Coalesce, 0);
+            if(!session->m_Coalesce) {
+                return false;
+            }
+
+            session->m_CoalesceSize = 0;
+            session->m_CoalesceType = type;
+            m_Coalesced.push_back(peer);
+        }
+
+        const auto frame = session->m_Coalesce->data + session->m_CoalesceSize;
+        frame[0] = channel;
+        frame[1] = static_cast<std::uint8_t>(size);
+        frame[2] = static_cast<std::uint8_t>(size >> 8);
+        if(size) {
+            std::memcpy(frame + CoalesceHeader, data, size);
+        }
+
+        session->m_CoalesceSize += CoalesceHeader + size;
+        m_MessagesCoalesced++;
+        return true;
+    }
+
+    inline void NetworkManager::Network::FlushCoalesced()
+    {
+        // Peer can be listed twice after reconnect, second flush finds no aggregate
+        for(const auto peer : m_Coalesced) {
+            FlushCoalesced(peer);
+        }
+
+        m_Coalesced.clear();
+    }
+
+    inline void NetworkManager::Network::FlushCoalesced(ENetPeer* peer)
+    {
+        const auto session = static_cast<Session*>(peer->data);
+        if(const auto aggregate = std::exchange(session->m_Coalesce, nullptr))
+        {
+            Packet packet{aggregate};
+            packet.Resize(session->m_CoalesceSize);
+            if(const auto data = packet.Release(session->m_CoalesceType)) {
+                if(const auto framed = Frame(peer, m_CoalesceChannel, data); framed && PeerSend(peer, m_CoalesceChannel, framed)) {
+                    m_PacketsCoalesced++;
+                }
+            }
+        }
+    }
+
+    inline void NetworkManager::Network::DropCoalesced(ENetPeer* peer)
+    {
+        const auto session = static_cast<Session*>(peer->data);
+        if(const auto aggregate = std::exchange(session->m_Coalesce, nullptr)) {
+            enet_packet_destroy(aggregate);
+        }
+    }
+
+    [[nodiscard]] inline ENetPacket* NetworkManager::Network::Frame(std::uint8_t channel, const ENetPacket* packet) const
+    {
+        constexpr std::uint32_t headerRaw = 1;
+        constexpr std::uint32_t headerCompressed = 3;   // Mode and 16 bit raw size
+
+        // Channel out of range is rejected here as enet_peer_send would do
+        if(channel >= m_CompressionStats.size()) {
+            return nullptr;
+        }
+
+        const auto size = static_cast<std::uint32_t>(packet->dataLength);
+        const auto framed = enet_packet_create(nullptr, headerRaw + size, packet->flags);
+        if(!framed) {
+            return nullptr;
+        }
+
+        auto& stats = m_CompressionStats[channel];
+        if(size >= m_Compression && size > headerCompressed)
+        {
+            const auto timeStart = Worker::GetTime();
+            const auto compressed = m_Compressor->Compress(packet->data, size, framed->data + headerCompressed, size - headerCompressed);
+            stats.compressTime += static_cast<std::uint64_t>(Worker::GetTime() - timeStart);
+
+            if(compressed) {
+                framed->data[0] = 1;
+                framed->data[1] = static_cast<std::uint8_t>(size);
+                framed->data[2] = static_cast<std::uint8_t>(size >> 8);
+                framed->dataLength = headerCompressed + compressed;
+                stats.rawBytes += size;
+                stats.compressedBytes += framed->dataLength;
+                stats.packetsCompressed++;
+                return framed;
+            }
+
+            stats.packetsSkipped++;
+        }
+
+        framed->data[0] = 0;
+        std::memcpy(framed->data + headerRaw, packet->data, size);
+        return framed;
+    }
+
+    [[nodiscard]] inline ENetPacket* NetworkManager::Network::Frame(ENetPeer* peer, std::uint8_t channel, ENetPacket* packet) const
+    {
+        const auto capabilities = static_cast<const Session*>(peer->data)->m_Capabilities;
+
+        // Compressed before sealed, cipher text does not compress
+        if(capabilities & CapabilityCompression) {
+            const auto framed = Frame(channel, packet);
+            if(!packet->referenceCount) {
+                enet_packet_destroy(packet);
+            }
+
+            packet = framed;
+            if(!packet) {
+                return nullptr;
+            }
+        }
+
+        if(capabilities & CapabilityEncryption) {
+            const auto sealed = Seal(peer, channel, packet);
+            if(!packet->referenceCount) {
+                enet_packet_destroy(packet);
+            }
+
+            packet = sealed;
+        }
+
+        return packet;
+    }
+
+    [[nodiscard]] inline ENetPacket* NetworkManager::Network::Unframe(ENetPeer* peer, std::uint8_t channel, ENetPacket* packet)
+    {
+        const auto data = packet->data;
+        const auto size = static_cast<std::uint32_t>(packet->dataLength);
+
+        if(size >= 1 && data[0] == 0) {
+            std::memmove(data, data + 1, size - 1);
+            packet->dataLength = size - 1;
+            return packet;
+        }
+
+        if(size >= 3 && data[0] == 1 && channel < m_CompressionStats.size())
+        {
+            const auto rawSize = static_cast<std::uint32_t>(data[1] | data[2] << 8);
+            if(const auto raw = enet_packet_create(nullptr, rawSize, packet->flags))
+            {
+                const auto timeStart = Worker::GetTime();
+                const auto decompressed = m_Compressor->Decompress(data + 3, size - 3, raw->data, rawSize);
+                m_CompressionStats[channel].decompressTime += static_cast<std::uint64_t>(Worker::GetTime() - timeStart);
+
+                if(decompressed) {
+                    enet_packet_destroy(packet);
+                    return raw;
+                }
+
+                enet_packet_destroy(raw);
+            }
+        }
+
+        HELENA_MSG_WARNING("Recv malformed compressed packet from connection: {}", Connection{this, peer}.GetID());
+        enet_packet_destroy(packet);
+        return nullptr;
+    }
+
+    [[nodiscard]] inline ENetPacket* NetworkManager::Network::Seal(ENetPeer* peer, std::uint8_t channel, const ENetPacket* packet) const
+    {
+        auto& cipher = static_cast<Session*>(peer->data)->m_Cipher;
+        if(channel >= cipher.m_SendOrdered.size()) {
+            return nullptr;
+        }
+
+        const auto size = packet->dataLength;
+        const auto sealed = enet_packet_create(nullptr, SequenceSize + size + Cipher::TagSize, packet->flags);
+        if(!sealed) {
+            return nullptr;
+        }
+
+        // Nonce is the channel, 24 bit zero and the sequence, sequence is never reused for the key, channel and kind of packet.
+        // Window would drop a reliable retransmit older than WindowSize newer packets, after ENet acknowledged it
+        const auto sequence = packet->flags & ENET_PACKET_FLAG_RELIABLE ? ++cipher.m_SendOrdered[channel] | Cipher::Ordered : ++cipher.m_SendSequence;
+        std::array<std::uint8_t, Cipher::NonceSize> nonce{};
+        nonce[0] = channel;
+        for(std::size_t index = 0; index < SequenceSize; ++index) {
+            nonce[4 + index] = sealed->data[index] = static_cast<std::uint8_t>(sequence >> index * 8);
+        }
+
+        Cipher::Seal(cipher.m_SendKey, nonce.data(), &channel, sizeof(channel), packet->data, size, sealed->data + SequenceSize);
+        return sealed;
+    }
+
+    [[nodiscard]] inline ENetPacket* NetworkManager::Network::Open(ENetPeer* peer, std::uint8_t channel, ENetPacket* packet)
+    {
+        auto& cipher = static_cast<Session*>(peer->data)->m_Cipher;
+        const auto data = packet->data;
+        const auto size = packet->dataLength;
+
+        if(size >= SequenceSize + Cipher::TagSize && channel < cipher.m_ReceiveOrdered.size())
+        {
+            std::uint64_t sequence{};
+            std::array<std::uint8_t, Cipher::NonceSize> nonce{};
+            nonce[0] = channel;
+            for(std::size_t index = 0; index < SequenceSize; ++index) {
+                sequence |= static_cast<std::uint64_t>(data[index]) << index * 8;
+                nonce[4 + index] = data[index];
+            }
+
+            // Reliable sequence is authenticated by the nonce, replay of an older one is rejected without the window
+            auto& ordered = cipher.m_ReceiveOrdered[channel];
+            const auto check = sequence & Cipher::Ordered ? sequence > ordered : Cipher::Check(cipher, sequence);
+
+            // Decrypted in place over the sequence
+            if(check && Cipher::Open(cipher.m_ReceiveKey, nonce.data(), &channel, sizeof(channel), data + SequenceSize, size - SequenceSize, data)) {
+                if(sequence & Cipher::Ordered) {
+                    ordered = sequence;
+                } else {
+                    Cipher::Accept(cipher, sequence);
+                }
+
+                packet->dataLength = size - SequenceSize - Cipher::TagSize;
+                return packet;
+            }
+        }
+
+        HELENA_MSG_WARNING("Recv packet failed authentication from connection: {}", Connection{this, peer}.GetID());
+        enet_packet_destroy(packet);
+        return nullptr;
+    }
+
+    inline void NetworkManager::Network::Multicast(std::uint8_t channel, ENetPacket* packet, const std::vector<std::vector<ENetPeer*>>& peers) const
+    {
+        if(m_Encryption)
+        {
+            // Keys and sequences are per connection, each peer gets own sealed copy of one compressed frame
+            ENetPacket* framed{};
+            for(const auto& members : peers) {
+                for(const auto peer : members)
+                {
+                    auto payload = packet;
+                    if(static_cast<const Session*>(peer->data)->m_Capabilities & CapabilityCompression) {
+                        if(!framed) {
+                            framed = Frame(channel, packet);
+                            if(framed) {
+                                framed->referenceCount++;
+                            }
+                        }
+                        payload = framed;
+                    }
+
+                    if(payload) {
+                        if(const auto sealed = Seal(peer, channel, payload)) {
+                            (void)PeerSend(peer, channel, sealed);
+                        }
+                    }
+                }
+            }
+
+            if(framed && !--framed->referenceCount) {
+                enet_packet_destroy(framed);
+            }
+            return;
+        }
+
+        if(!m_Compressor) {
+            SendShards(channel, packet, peers);
+            return;
+        }
+
+        std::vector<std::vector<ENetPeer*>> framedPeers(peers.size());
+        std::vector<std::vector<ENetPeer*>> plainPeers(peers.size());
+        bool framedAny{};
+
+        for(std::size_t shard = 0; shard < peers.size(); ++shard) {
+            for(const auto peer : peers[shard]) {
+                const auto framed = static_cast<const Session*>(peer->data)->m_Capabilities & CapabilityCompression;
+                (framed ? framedPeers : plainPeers)[shard].push_back(peer);
+                framedAny |= framed != 0;
+            }
         }
 
-        if(m_Host)
-        {
-            ENetAddress address{};
-            if(CreateAddress(address, config.GetIP(), config.GetPort()))
-            {
-                if(const auto peer = enet_host_connect(m_Host, &address, config.GetChannels(), config.GetData())) 
-                {
-                    const auto session = static_cast<Session*>(peer->data);
-                    session->m_State = EStateConnection::Connecting;
-                    session->m_Sequence++;
-                    session->m_UserData.reset();
-                    session->m_HandshakeKey = 0;
-                    return true;
-                } else {
-                    HELENA_MSG_ERROR("Connect to server ip: {}, port: {} failed!", config.GetIP(), config.GetPort());
+        // One compressed copy for all peers with compression
+        if(framedAny) {
+            if(const auto framed = Frame(channel, packet)) {
+                framed->referenceCount++;
+                SendShards(channel, framed, framedPeers);
+                if(!--framed->referenceCount) {
+                    enet_packet_destroy(framed);
                 }
             }
         }
 
-        return false;
+        SendShards(channel, packet, plainPeers);
     }
 
-    inline void NetworkManager::Network::Shutdown() 
+    inline void NetworkManager::Network::SendShards(std::uint8_t channel, ENetPacket* packet, const std::vector<std::vector<ENetPeer*>>& peers) const
     {
-        if(Valid()) 
+        for(std::size_t shard = 0; shard < m_Shards.size(); ++shard)
         {
-            const auto peer = m_Host->peers;
-            delete[] static_cast<Session*>(peer->data);
+            const auto& [host, worker, watched] = m_Shards[shard];
+            const auto& members = peers[shard];
+            if(members.empty()) {
+                continue;
+            }
+
+            if(worker) {
+                // Shard copy is shared by its commands and released by I/O thread
+                const auto copy = enet_packet_create(packet->data, packet->dataLength, packet->flags);
+                if(!copy) {
+                    continue;
+                }
+
+                copy->referenceCount = members.size();
+                for(const auto peer : members) {
+                    Outbound command{};
+                    command.type = ECommand::SendShared;
+                    command.peer = peer;
+                    command.packet = copy;
+                    command.connectID = static_cast<const Session*>(peer->data)->m_ConnectID;
+                    command.channel = channel;
+                    worker->Post(command);
+                }
+                continue;
+            }
 
-            enet_host_flush(m_Host);
-            enet_host_destroy(m_Host);
+            enet_host_broadcast_selective(host, channel, packet, const_cast<ENetPeer**>(members.data()), members.size());
         }
     }
 
-    inline void NetworkManager::Network::Broadcast(EMessage type, std::uint8_t channel, const std::uint8_t* data, std::uint32_t size) const
+    inline void NetworkManager::Network::Update(Shard& shard, std::int64_t deadline)
     {
-        if(Valid())
+        constexpr std::size_t batchSize = 64;
+        constexpr std::size_t firstBatchSize = 8;
+
+        const auto& [host, worker, watched] = shard;
+        auto timeBatch = Worker::GetTime();
+        auto batchLimit = deadline ? firstBatchSize : batchSize;
+
+        // Events fitting the rest of the budget by measured cost, at least one so each shard make progress
+        const auto request = [&]() -> std::size_t {
+            if(!deadline) {
+                return batchSize;
+            }
+
+            const auto remaining = std::max<std::int64_t>(deadline - timeBatch, 0);
+            return std::clamp<std::size_t>(static_cast<std::size_t>(remaining / std::max<std::uint32_t>(m_EventCost, 1)), 1, batchLimit);
+        };
+
+        // Cost rises at once and decays with 1/8 weight, first small batch measures it before batches grow
+        const auto measure = [&](std::size_t count) {
+            const auto timeNow = Worker::GetTime();
+            const auto cost = static_cast<std::int64_t>((timeNow - timeBatch) / static_cast<std::int64_t>(count));
+            const auto average = cost > m_EventCost ? cost : m_EventCost + (cost - m_EventCost) / 8;
+            m_EventCost = static_cast<std::uint32_t>(std::clamp<std::int64_t>(average, 1, std::numeric_limits<std::uint32_t>::max()));
+            m_EventsProcessed += static_cast<std::uint32_t>(count);
+            batchLimit = batchSize;
+            timeBatch = timeNow;
+        };
+
+        if(worker)
         {
-            if(void* memory = enet_malloc(sizeof(ENetPacket) + size))
+            while(true)
             {
-                const auto packet = static_cast<ENetPacket*>(memory);
+                const auto limit = request();
+                std::size_t count{};
 
-                switch(type)
+                Inbound inbound{};
+                while(count < limit && worker->m_Inbound.Pop(inbound))
                 {
-                    case EMessage::None:        packet->flags = 0; break;
-                    case EMessage::Reliable:    packet->flags = ENetPacketFlag::ENET_PACKET_FLAG_RELIABLE; break;
-                    case EMessage::Fragmented:  packet->flags = ENetPacketFlag::ENET_PACKET_FLAG_UNRELIABLE_FRAGMENTED; break;
-                    case EMessage::Unsequenced: packet->flags = ENetPacketFlag::ENET_PACKET_FLAG_UNSEQUENCED; break;
+                    const auto latency = static_cast<std::uint64_t>(Worker::GetTime() - inbound.time);
+                    worker->m_LatencyCount++;
+                    worker->m_LatencyTotal += latency;
+                    worker->m_LatencyMax = std::max(worker->m_LatencyMax, latency);
+
+                    Dispatch(inbound.event, inbound.connectID);
+                    count++;
+                }
+
+                if(!count) {
+                    break;
                 }
 
-                packet->data = static_cast<std::uint8_t*>(memory) + sizeof(ENetPacket);
-                packet->referenceCount = 0;
-                packet->dataLength = size;
-                packet->freeCallback = nullptr;
-                packet->userData = nullptr;
+                measure(count);
+
+                if(count < limit) {
+                    break;
+                }
 
-                std::memcpy(packet->data, data, size);
-                enet_host_broadcast(m_Host, channel, packet);
+                if(deadline && timeBatch >= deadline) {
+                    m_EventsDeferred += static_cast<std::uint32_t>(worker->m_Inbound.Size());
+                    break;
+                }
             }
+
+            return;
         }
-    }
 
-    [[nodiscard]] inline std::uint16_t NetworkManager::Network::GetID() const noexcept {
-        return m_NetworkID;
-    }
+        // One sweep, receive drain and dispatch per batch instead of a sweep per event
+        std::array<ENetEvent, batchSize> events;
 
-    inline void NetworkManager::Network::SetUserData(std::unique_ptr<NetworkManager::UserData> data) {
-        m_UserData = std::move(data);
-    }
+        while(true)
+        {
+            const auto limit = request();
+            const auto count = enet_host_service_batch(host, events.data(), limit);
+            if(count <= 0) {
+                break;
+            }
 
-    template <typename T>
-    requires std::is_base_of_v<NetworkManager::UserData, T>
-    [[nodiscard]] T* NetworkManager::Network::GetUserData() noexcept {
-        return static_cast<T*>(m_UserData.get());
-    }
+            for(int index = 0; index < count; ++index) {
+                Dispatch(events[index], events[index].peer ? events[index].peer->connectID : 0);
+            }
 
-    template <typename T>
-    requires std::is_base_of_v<NetworkManager::UserData, T>
-    [[nodiscard]] const T* NetworkManager::Network::GetUserData() const noexcept {
-        return static_cast<const T*>(m_UserData.get());
-    }
+            measure(static_cast<std::size_t>(count));
 
-    [[nodiscard]] inline bool NetworkManager::Network::Server() const noexcept {
-        HELENA_ASSERT(Valid(), "Network invalid");
-        return m_Server;
-    }
+            if(static_cast<std::size_t>(count) < limit) {
+                break;
+            }
 
-    [[nodiscard]] inline bool NetworkManager::Network::Valid() const noexcept {
-        return m_Initialized && m_Host;
-    }
+            if(deadline && timeBatch >= deadline) {
+                m_EventsDeferred += static_cast<std::uint32_t>(enet_host_get_pending_events(host));
+                break;
+            }
+        }
 
-    template <typename Func>
-    void NetworkManager::Network::Each(Func&& func) 
-    {
-        HELENA_ASSERT(Valid(), "Network invalid");
-        for(auto peer = m_Host->peers; peer < &m_Host->peers[m_Host->peerCount]; ++peer) {
-            func(NetworkManager::Connection{this, peer});
+        // Acknowledgements and replies queued by handlers leave in the same tick
+        if(ENET_TIME_LESS_EQUAL(enet_host_get_service_deadline(host), enet_time_get())) {
+            enet_host_flush(host);
         }
     }
 
-    template <typename Func>
-    void NetworkManager::Network::Each(Func&& func) const 
-    {
-        HELENA_ASSERT(Valid(), "Network invalid");
-        for(const auto* peer = m_Host->peers; peer < &m_Host->peers[m_Host->peerCount]; ++peer) {
-            func(NetworkManager::Connection{this, peer});
-        }
+    inline void NetworkManager::Network::UpdateHandshakes() {
+        m_Handshakes.Expire(enet_time_get(), [this](ENetPeer* peer) {
+            PeerReset(peer);
+        });
     }
 
-    [[nodiscard]] inline bool NetworkManager::Network::CreateAddress(ENetAddress& address, const std::string_view ip, std::uint16_t port)
+    inline void NetworkManager::Network::UpdateCookies()
     {
-        address.port = port;
-        if(enet_address_set_ip(&address, ip.data())) {
-            HELENA_MSG_ERROR("Create address with ip: {}, port: {} failed!", ip, port);
-            return false;
-        }
+        constexpr std::int64_t samplePeriod = 1'000'000'000;
 
-        return true;
-    }
+        if(!m_Cookies || !m_Server) {
+            return;
+        }
 
-    [[nodiscard]] inline ENetHost* NetworkManager::Network::CreateHost(const Config& config, bool server)
-    {
-        ENetHost* host{};
+        const auto time = Worker::GetTime();
+        if(time - m_CookieSampleTime < samplePeriod) {
+            return;
+        }
 
-        if(server) {
-            ENetAddress address{};
-            if(CreateAddress(address, config.GetIP(), config.GetPort())) {
-                host = enet_host_create(&address, config.GetPeers(), config.GetChannels(),
-                    config.GetBandwidthIn(), config.GetBandwidthOut(), config.GetBufferSize());
-            }
-        } else {
-            host = enet_host_create(nullptr, config.GetPeers(), 1,
-                config.GetBandwidthIn(), config.GetBandwidthOut(), config.GetBufferSize());
+        std::uint32_t rejects{};
+        for(const auto& [host, worker, watched] : m_Shards) {
+            rejects += worker ? worker->m_CookieRejects.load(std::memory_order_relaxed) : enet_host_get_cookie_rejects(host);
         }
 
-        if(host)
-        {
-            Session* sessions = new Session[host->peerCount]{};
-            for(auto currentPeer = host->peers; currentPeer < &host->peers[host->peerCount]; ++currentPeer) {
-                currentPeer->data = sessions++;
-            }
-        } else {
-            HELENA_MSG_ERROR("Create host with ip: {}, port: {}, peers: {}, channels: {} failed!",
-                config.GetIP(), config.GetPort(), config.GetPeers(), config.GetChannels());
+        if(m_CookieSampleTime) {
+            m_CookieRejectRate = static_cast<std::uint32_t>((rejects - m_CookieSampleRejects) * samplePeriod / (time - m_CookieSampleTime));
         }
-        return host;
-    }
 
-    [[nodiscard]] inline std::int64_t NetworkManager::Network::Scramble(std::int64_t value) noexcept {
-        std::int64_t out = value ^ 0xDEADBEEFC0DECAFE;
-        //out = (out & 0xF0F0F0F0F0F0F0) >> 4 | (out & 0x0F0F0F0F0F0F0F) << 4;
-        return out ^ 0xC0DEFACE12345678;
+        m_CookieSampleTime = time;
+        m_CookieSampleRejects = rejects;
     }
 
-    inline bool NetworkManager::Network::SendHandshake(ENetPeer* peer, std::int64_t key)
+    inline void NetworkManager::Network::Dispatch(ENetEvent& event, std::uint32_t connectID)
     {
-        const auto crypt    = Scramble(key);
-        const auto packet   = enet_packet_create(reinterpret_cast<const std::uint8_t*>(&crypt),
-            sizeof(std::int64_t), ENetPacketFlag::ENET_PACKET_FLAG_RELIABLE);
-        if(!packet || enet_peer_send(peer, 0, packet)) {
-            enet_peer_reset(peer);
-            enet_packet_destroy(packet);
-            return false;
-        }
+        switch(event.type)
+        {
+            case ENET_EVENT_TYPE_NONE:
+            {
+                // Connection started by I/O thread in threaded mode
+                if(event.peer) {
+                    const auto session = static_cast<Session*>(event.peer->data);
+                    session->m_State = EStateConnection::Connecting;
+                    session->m_Sequence++;
+                    session->m_UserData.reset();
+                    session->m_HandshakeKey = 0;
+                    session->m_Capabilities = 0;
+                    session->m_Cipher = {};
+                    session->m_ConnectID = connectID;
+                }
+            } break;
+            case ENET_EVENT_TYPE_CONNECT:
+            {
+                const auto session = static_cast<Session*>(event.peer->data);
+                session->m_State = EStateConnection::Handshake;
+                session->m_ConnectID = connectID;
+                session->m_ConnectData = event.data;
+                session->m_Capabilities = 0;
+                session->m_Cipher = {};
+
+                if(m_Server)
+                {
+                    constexpr auto timeoutHandshake = 2;
 
-        return true;
-    }
+                    if(m_Encryption) {
+                        Cipher::Random(session->m_Cipher.m_Salt.data(), HandshakeNonceSize);
+                    }
 
-    inline void NetworkManager::Network::AddHandshake(ENetPeer* peer) {
-        m_HandshakeList.emplace_back(this, peer);
-    }
+                    session->m_Sequence++;
+                    session->m_UserData.reset();
+                    session->m_HandshakeKey = std::chrono::duration_cast<std::chrono::seconds>(
+                        std::chrono::steady_clock::now().time_since_epoch()).count() + timeoutHandshake;
 
-    inline void NetworkManager::Network::RemoveHandshake(ENetPeer* peer) 
-    {
-        const auto id = enet_peer_get_id(peer);
-        const auto it = std::find_if(m_HandshakeList.cbegin(), m_HandshakeList.cend(), [id](const auto conn) {
-            return conn.GetID() == id;
-        });
+                    if(SendHandshake(event.peer, Scramble(session->m_HandshakeKey))) {
+                        AddHandshake(event.peer, timeoutHandshake * 1000);
+                    }
+                }
 
-        if(it != m_HandshakeList.cend()) {
-            m_HandshakeList.erase(it);
-        }
-    }
+            } break;
+            case ENET_EVENT_TYPE_DISCONNECT: {
+                if(m_Server) {
+                    RemoveHandshake(event.peer);
+                }
 
-    inline void NetworkManager::Network::Update(std::uint32_t timeout, std::uint32_t eventsLimit)
-    {
-        while(true)
-        {
-            ENetEvent event{};
-            if(enet_host_check_events(m_Host, &event) <= 0)
-            {
-                if(enet_host_service(m_Host, &event, timeout) <= 0) {
-                    break;
+                RemoveConnection(event.peer);
+
+                Connection conn{this, event.peer};
+                Helena::Engine::SignalEvent<Events::NetworkManager::Event>(conn, event.data, EStateEvent::Disconnect);
+                static_cast<Session*>(event.peer->data)->m_State = EStateConnection::Disconnected;
+            } break;
+            case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT: {
+                if(m_Server) {
+                    RemoveHandshake(event.peer);
                 }
-            }
 
-            switch(event.type)
+                RemoveConnection(event.peer);
+
+                Connection conn{this, event.peer};
+                Helena::Engine::SignalEvent<Events::NetworkManager::Event>(conn, event.data, EStateEvent::Timeout);
+                static_cast<Session*>(event.peer->data)->m_State = EStateConnection::Disconnected;
+            } break;
+            case ENET_EVENT_TYPE_RECEIVE:
             {
-                case ENET_EVENT_TYPE_NONE: break;
-                case ENET_EVENT_TYPE_CONNECT:
-                {
-                    const auto session = static_cast<Session*>(event.peer->data);
-                    session->m_State = EStateConnection::Handshake;
+                Connection conn{this, event.peer};
+                const auto session = static_cast<Session*>(event.peer->data);
 
-                    if(m_Server)
+                if(session->m_State == EStateConnection::Handshake)
+                {
+                    if(event.packet->dataLength != sizeof(std::int64_t) && event.packet->dataLength != HandshakeSize) 
                     {
-                        constexpr auto timeoutHandshake = 2;
+                        if(m_Server) {
+                            RemoveHandshake(event.peer);
+                        }
+                        PeerReset(event.peer);
+                        enet_packet_destroy(event.packet);
+                        break;
+                    }
 
-                        session->m_Sequence++;
-                        session->m_UserData.reset();
-                        session->m_HandshakeKey = std::chrono::duration_cast<std::chrono::seconds>(
-                            std::chrono::steady_clock::now().time_since_epoch()).count() + timeoutHandshake;
+                    const auto decrypt = Scramble(*reinterpret_cast<std::int64_t*>(event.packet->data));
+                    session->m_Capabilities = event.packet->dataLength == HandshakeSize ? Negotiate(event.packet->data) : 0;
 
-                        if(SendHandshake(event.peer, Scramble(session->m_HandshakeKey))) {
-                            AddHandshake(event.peer);
+                    // Encrypted side never falls back to plain payloads
+                    if(m_Encryption && !(session->m_Capabilities & CapabilityEncryption)) 
+                    {
+                        HELENA_MSG_WARNING("Connection without encryption rejected!");
+                        if(m_Server) {
+                            RemoveHandshake(event.peer);
                         }
+                        PeerReset(event.peer);
+                        enet_packet_destroy(event.packet);
+                        break;
                     }
 
-                } break;
-                case ENET_EVENT_TYPE_DISCONNECT: {
-                    Connection conn{this, event.peer};
-                    Helena::Engine::SignalEvent<Events::NetworkManager::Event>(conn, event.data, EStateEvent::Disconnect);
-                    static_cast<Session*>(event.peer->data)->m_State = EStateConnection::Disconnected;
-                } break;
-                case ENET_EVENT_TYPE_DISCONNECT_TIMEOUT: {
-                    Connection conn{this, event.peer};
-                    Helena::Engine::SignalEvent<Events::NetworkManager::Event>(conn, event.data, EStateEvent::Timeout);
-                    static_cast<Session*>(event.peer->data)->m_State = EStateConnection::Disconnected;
-                } break;
-                case ENET_EVENT_TYPE_RECEIVE:
-                {
-                    Connection conn{this, event.peer};
-                    const auto session = static_cast<Session*>(event.peer->data);
+                    // Remote nonce, client half of the salt on server
+                    if(session->m_Capabilities & CapabilityEncryption) {
+                        std::memcpy(session->m_Cipher.m_Salt.data() + (m_Server ? HandshakeNonceSize : 0), 
+                            event.packet->data + HandshakeSize - HandshakeNonceSize, HandshakeNonceSize);
+                    }
 
-                    if(session->m_State == EStateConnection::Handshake)
+                    if(m_Server)
                     {
-                        if(event.packet->dataLength != sizeof(std::int64_t)) 
-                        {
-                            if(m_Server) {
-                                RemoveHandshake(event.peer);
-                            }
-                            enet_peer_reset(event.peer);
+                        RemoveHandshake(event.peer);
+
+                        session->m_HandshakeKey = session->m_HandshakeKey ^ GetHandshakeSalt(event.peer);
+                        if(session->m_HandshakeKey != decrypt || !SendHandshake(event.peer, Scramble(session->m_HandshakeKey))) {
+                            PeerReset(event.peer);
                             enet_packet_destroy(event.packet);
                             break;
                         }
 
-                        const auto decrypt = Scramble(*reinterpret_cast<std::int64_t*>(event.packet->data));
-                        if(m_Server)
-                        {
-                            RemoveHandshake(event.peer);
-
-                            session->m_HandshakeKey = session->m_HandshakeKey ^ (conn.GetID() + 1uLL);
-                            if(session->m_HandshakeKey != decrypt || !SendHandshake(event.peer, Scramble(session->m_HandshakeKey))) {
-                                enet_peer_reset(event.peer);
-                                enet_packet_destroy(event.packet);
-                                break;
+                        session->m_State = EStateConnection::Connected;
+                        SetupCipher(event.peer);
+                        AddConnection(event.peer);
+                        Helena::Engine::SignalEvent<Events::NetworkManager::Event>(conn, session->m_ConnectData, EStateEvent::Connect);
+                    }
+                    else
+                    {
+                        if(!session->m_HandshakeKey) {
+                            session->m_HandshakeKey = decrypt ^ GetHandshakeSalt(event.peer);
+                            if(m_Encryption) {
+                                Cipher::Random(session->m_Cipher.m_Salt.data() + HandshakeNonceSize, HandshakeNonceSize);
                             }
-
+                            (void)SendHandshake(event.peer, Scramble(session->m_HandshakeKey));
+                        } else if(session->m_HandshakeKey == decrypt) {
                             session->m_State = EStateConnection::Connected;
-                            Helena::Engine::SignalEvent<Events::NetworkManager::Event>(conn, event.peer->eventData, EStateEvent::Connect);
+                            SetupCipher(event.peer);
+                            AddConnection(event.peer);
+                            Helena::Engine::SignalEvent<Events::NetworkManager::Event>(conn, session->m_ConnectData, EStateEvent::Connect);
+                        } else {
+                            PeerReset(event.peer);
                         }
-                        else
-                        {
-                            if(!session->m_HandshakeKey) {
-                                session->m_HandshakeKey = decrypt ^ (conn.GetID() + 1uLL);
-                                (void)SendHandshake(event.peer, Scramble(session->m_HandshakeKey));
-                            } else if(session->m_HandshakeKey == decrypt) {
-                                session->m_State = EStateConnection::Connected;
-                                Helena::Engine::SignalEvent<Events::NetworkManager::Event>(conn, event.peer->eventData, EStateEvent::Connect);
-                            } else {
-                                enet_peer_reset(event.peer);
-                            }
 
-                        }
+                    }
 
-                        enet_packet_destroy(event.packet);
+                    enet_packet_destroy(event.packet);
+                    break;
+                } 
+
+                if(session->m_Capabilities & CapabilityEncryption) {
+                    event.packet = Open(event.peer, event.channelID, event.packet);
+                    if(!event.packet) {
                         break;
-                    } 
+                    }
+                }
 
-                    EMessage type{};
-                    switch(event.packet->flags)
-                    {
-                        case 0: type = EMessage::None; break;
-                        case ENetPacketFlag::ENET_PACKET_FLAG_RELIABLE: type = EMessage::Reliable; break;
-                        case ENetPacketFlag::ENET_PACKET_FLAG_UNRELIABLE_FRAGMENTED: type = EMessage::Fragmented; break;
-                        case ENetPacketFlag::ENET_PACKET_FLAG_UNSEQUENCED: type = EMessage::Unsequenced; break;
-                        default: {
-                            HELENA_MSG_WARNING("Recv not supported message flag: {}", event.packet->flags);
-                            type = EMessage::Reliable;   // by default unknown flags replaced on Reliable
-                        } break;
+                if(session->m_Capabilities & CapabilityCompression) {
+                    event.packet = Unframe(event.peer, event.channelID, event.packet);
+                    if(!event.packet) {
+                        break;
                     }
+                }
 
-                    Helena::Engine::SignalEvent<Events::NetworkManager::Message>(conn, event.packet->data, event.packet->dataLength, type, event.channelID);
-                    enet_packet_destroy(event.packet);
-                } break;
-            }
+                EMessage type{};
+                switch(event.packet->flags)
+                {
+                    case 0: type = EMessage::None; break;
+                    case ENetPacketFlag::ENET_PACKET_FLAG_RELIABLE: type = EMessage::Reliable; break;
+                    case ENetPacketFlag::ENET_PACKET_FLAG_UNRELIABLE_FRAGMENTED: type = EMessage::Fragmented; break;
+                    case ENetPacketFlag::ENET_PACKET_FLAG_UNSEQUENCED: type = EMessage::Unsequenced; break;
+                    default: {
+                        HELENA_MSG_WARNING("Recv not supported message flag: {}", event.packet->flags);
+                        type = EMessage::Reliable;   // by default unknown flags replaced on Reliable
+                    } break;
+                }
 
-            if(event.type != ENET_EVENT_TYPE_NONE && eventsLimit) 
-            {
-                eventsLimit--;
-                if(!eventsLimit) {
+                if(m_Coalesce && event.channelID == m_CoalesceChannel) {
+                    DispatchCoalesced(conn, event.packet, type);
                     break;
                 }
+
+                if(m_RetainPackets) {
+                    Publish(conn, event.packet->data, static_cast<std::uint32_t>(event.packet->dataLength), type, event.channelID, Packet{event.packet});
+                    break;
+                }
+
+                Publish(conn, event.packet->data, static_cast<std::uint32_t>(event.packet->dataLength), type, event.channelID);
+                enet_packet_destroy(event.packet);
+            } break;
+        }
+    }
+
+    inline void NetworkManager::Network::DispatchCoalesced(const Connection& conn, ENetPacket* aggregate, EMessage type)
+    {
+        // Messages point into the aggregate, retained handles share it
+        const Packet packet{aggregate};
+        const auto data = aggregate->data;
+        const auto size = aggregate->dataLength;
+
+        for(std::size_t offset = 0; offset < size;)
+        {
+            if(size - offset < CoalesceHeader) {
+                HELENA_MSG_WARNING("Recv malformed coalesced packet from connection: {}", conn.GetID());
+                break;
+            }
+
+            const auto channel = data[offset];
+            const auto length = static_cast<std::uint32_t>(data[offset + 1] | data[offset + 2] << 8);
+            offset += CoalesceHeader;
+
+            if(length > size - offset) {
+                HELENA_MSG_WARNING("Recv malformed coalesced packet from connection: {}", conn.GetID());
+                break;
+            }
+
+            if(m_RetainPackets) {
+                Publish(conn, data + offset, length, type, channel, packet);
+            } else {
+                Publish(conn, data + offset, length, type, channel);
             }
+
+            offset += length;
         }
+    }
 
-        if(!m_HandshakeList.empty())
+    inline void NetworkManager::Network::Publish(const Connection& conn, std::uint8_t* data, std::uint32_t size, EMessage type, std::uint8_t channel, Packet packet)
+    {
+        if(!m_Router.Empty() && size >= Router::HeaderSize)
         {
-            const auto connection = m_HandshakeList.front();
-            const auto timenow  = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
-            const auto session  = static_cast<const Session*>(connection.m_Peer->data);
-            if(timenow >= session->m_HandshakeKey) {
-                m_HandshakeList.erase(m_HandshakeList.begin());
-                enet_peer_reset(connection.m_Peer);
+            // Unknown ids fall back to the event with the id left in data
+            const auto id = static_cast<std::uint16_t>(data[0] | data[1] << 8);
+            if(m_Router.Contains(id)) {
+                m_Router.Route(id, {conn, data + Router::HeaderSize, size - Router::HeaderSize, type, channel, std::move(packet)});
+                return;
             }
         }
+
+        Helena::Engine::SignalEvent<Events::NetworkManager::Message>(conn, data, size, type, channel, std::move(packet));
     }
 
     /* -------------- [NetworkManager] ------------- */
-    inline NetworkManager::NetworkManager() : m_Networks{}, m_NetworkSequenceID{}, m_Initialized{} {
+    inline NetworkManager::NetworkManager() : m_Networks{}, m_Poller{}, m_NetworkSequenceID{}, m_Initialized{} {
         Engine::SubscribeEvent<Events::Engine::Tick>(&NetworkManager::Tick);
     }
 
@@ -584,17 +3474,90 @@ namespace Helena::Systems
         return m_Networks.end();
     }
 
-    inline void NetworkManager::Tick(const Helena::Events::Engine::Tick ev)
+    inline void NetworkManager::Service(std::uint32_t timeout)
     {
+        const auto timeWait = enet_time_get();
+        auto wait = timeout;
+
+        // Sleep until nearest ENet timer, idle hosts are due at least once per second
+        for(auto& net : m_Networks)
+        {
+            if(!net.Valid()) {
+                continue;
+            }
+
+            // Aggregates collected since last Service are queued before deadlines are taken
+            net.FlushCoalesced();
+
+            for(auto& [host, worker, watched] : net.m_Shards)
+            {
+                if(worker)
+                {
+                    // Socket belongs to I/O thread, tick waits on its inbound ring
+                    m_Poller.Unwatch(host->socket, watched);
+
+                    if(worker->m_Event >= 0) {
+                        m_Poller.Watch(worker->m_Event, worker->m_Watched);
+                    } else {
+                        wait = std::min<std::uint32_t>(wait, 1);
+                    }
+
+                    if(worker->m_Inbound.Size()) {
+                        wait = 0;
+                    }
+
+                    continue;
+                }
+
+                m_Poller.Watch(host->socket, watched);
+
+                const auto deadline = enet_host_get_service_deadline(host);
+                wait = ENET_TIME_LESS_EQUAL(deadline, timeWait) ? 0 : std::min(wait, ENET_TIME_DIFFERENCE(deadline, timeWait));
+            }
+        }
+
+        m_Poller.Wait(wait);
+
+        const auto timeReady = enet_time_get();
         for(auto& net : m_Networks)
         {
             if(!net.Valid()) {
                 continue;
             }
 
-            net.Update();
+            // Budget is shared by shards of the network
+            const auto deadline = net.m_Budget ? Worker::GetTime() + net.m_Budget * 1000ll : 0;
+            net.m_EventsProcessed = 0;
+            net.m_EventsDeferred = 0;
+
+            // Shards can be removed by event handlers
+            for(std::size_t index = 0; index < net.m_Shards.size(); ++index)
+            {
+                auto& shard = net.m_Shards[index];
+                if(const auto& worker = shard.m_Worker)
+                {
+                    if(worker->m_Event >= 0 && m_Poller.Ready(worker->m_Event)) {
+                        worker->Acknowledge();
+                    }
+
+                    if(worker->m_Inbound.Size()) {
+                        net.Update(shard, deadline);
+                    }
+                } 
+                else if(m_Poller.Ready(shard.m_Host->socket) || ENET_TIME_LESS_EQUAL(enet_host_get_service_deadline(shard.m_Host), timeReady)) {
+                    net.Update(shard, deadline);
+                }
+            }
+
+            net.UpdateHandshakes();
+            net.UpdateCookies();
         }
     }
+
+    inline void NetworkManager::Tick(const Helena::Events::Engine::Tick ev)
+    {
+        Service(0);
+    }
 }
 
 #endif // HELENA_SYSTEMS_NETWORKMANAGER_IPP
\ No newline at end of file
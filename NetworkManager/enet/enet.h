@@ -29,6 +29,12 @@
 #include <stdint.h>
 #include <time.h>
 
+#if defined(__x86_64__) || defined(_M_X64)
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
 #define ENET_VERSION_MAJOR 2
 #define ENET_VERSION_MINOR 4
 #define ENET_VERSION_PATCH 7
@@ -119,6 +125,10 @@ typedef struct {
 #include <errno.h>
 #include <fcntl.h>
 
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#endif
+
 #ifdef __APPLE__
 #include <mach/clock.h>
 #include <mach/mach.h>
@@ -129,6 +139,10 @@ typedef struct {
 #define MSG_NOSIGNAL 0
 #endif
 
+#if defined(__linux__) && defined(_GNU_SOURCE)
+#define ENET_USE_MMSG
+#endif
+
 #ifdef MSG_MAXIOVLEN
 #define ENET_BUFFER_MAXIMUM MSG_MAXIOVLEN
 #endif
@@ -423,7 +437,9 @@ extern "C" {
 		ENET_SOCKOPT_SNDTIMEO = 7,
 		ENET_SOCKOPT_ERROR = 8,
 		ENET_SOCKOPT_NODELAY = 9,
-		ENET_SOCKOPT_IPV6_V6ONLY = 10
+		ENET_SOCKOPT_IPV6_V6ONLY = 10,
+		ENET_SOCKOPT_REUSEPORT = 11,
+		ENET_SOCKOPT_TXTIME = 12
 	} ENetSocketOption;
 
 	typedef enum _ENetSocketShutdown {
@@ -484,6 +500,9 @@ extern "C" {
 		uint16_t sendAttempts;
 		ENetProtocol command;
 		ENetPacket* packet;
+		uint32_t replaceKey;
+		uint64_t queueTime;
+		uint64_t sentData;
 	} ENetOutgoingCommand;
 
 	typedef struct _ENetIncomingCommand {
@@ -517,6 +536,17 @@ extern "C" {
 		ENET_HOST_DEFAULT_MTU = 1400,
 		ENET_HOST_DEFAULT_MAXIMUM_PACKET_SIZE = 32 * 1024 * 1024,
 		ENET_HOST_DEFAULT_MAXIMUM_WAITING_DATA = 32 * 1024 * 1024,
+		ENET_HOST_RECEIVE_BATCH_MAX = 64,
+		ENET_HOST_SEND_BATCH_MAX = 64,
+		ENET_HOST_COOKIE_PERIOD = 16000,
+		ENET_HOST_COOKIE_RETRY = 500,
+		ENET_HOST_COOKIE_REQUEST_SIZE = 16,
+		ENET_HOST_COOKIE_REPLY_SIZE = 12,
+		ENET_HOST_COOKIE_ATTEMPT_SIZE = 4,
+		ENET_HOST_RATE_LIMIT_PROBES = 8,
+		ENET_HOST_RATE_LIMIT_TABLE_MIN = 256,
+		ENET_HOST_RATE_LIMIT_TOKEN = 1000,
+		ENET_HOST_QUEUE_DELAY_BUCKETS = 24,
 		ENET_PEER_DEFAULT_ROUND_TRIP_TIME = 1,
 		ENET_PEER_DEFAULT_PACKET_THROTTLE = 32,
 		ENET_PEER_PACKET_THROTTLE_THRESHOLD = 40,
@@ -535,9 +565,37 @@ extern "C" {
 		ENET_PEER_FREE_UNSEQUENCED_WINDOWS = 32,
 		ENET_PEER_RELIABLE_WINDOWS = 16,
 		ENET_PEER_RELIABLE_WINDOW_SIZE = 0x1000,
-		ENET_PEER_FREE_RELIABLE_WINDOWS = 8
+		ENET_PEER_FREE_RELIABLE_WINDOWS = 8,
+		ENET_PEER_SCHEDULE_SCALE = 0x10000,
+		ENET_PEER_PACING_BURST = 20,
+		ENET_PEER_PACING_QUANTUM = 1,
+		ENET_PEER_LATEST_MINIMUM = 16,
+		ENET_PEER_DELAY_BANDWIDTH_ROUNDS = 10,
+		ENET_PEER_DELAY_ROUND_TRIP_WINDOW = 10000,
+		ENET_PEER_DELAY_PROBE_TIME = 200,
+		ENET_PEER_DELAY_FULL_ROUNDS = 3,
+		ENET_PEER_DELAY_CYCLE_LENGTH = 8,
+		ENET_PEER_DELAY_GAIN_SCALE = 256,
+		ENET_PEER_DELAY_HIGH_GAIN = 739,
+		ENET_PEER_DELAY_DRAIN_GAIN = 88,
+		ENET_PEER_DELAY_WINDOW_GAIN = 512,
+		ENET_PEER_DELAY_MINIMUM_WINDOW = 4,
+		ENET_PEER_DELAY_INITIAL_WINDOW = 10
 	};
 
+	typedef enum _ENetDelayMode {
+		ENET_DELAY_MODE_STARTUP = 0,
+		ENET_DELAY_MODE_DRAIN = 1,
+		ENET_DELAY_MODE_PROBE_BANDWIDTH = 2,
+		ENET_DELAY_MODE_PROBE_ROUND_TRIP = 3
+	} ENetDelayMode;
+
+	typedef enum _ENetPacing {
+		ENET_PACING_NONE = 0,		/* Only congestion control with a rate paces */
+		ENET_PACING_TIMER = 1,		/* Data is held until its departure time, service deadline wakes the host */
+		ENET_PACING_TXTIME = 2		/* Departure time is passed to the kernel with SO_TXTIME, fq qdisc spreads datagrams */
+	} ENetPacing;
+
 	typedef struct _ENetChannel {
 		uint16_t outgoingReliableSequenceNumber;
 		uint16_t outgoingUnreliableSequenceNumber;
@@ -547,8 +605,26 @@ extern "C" {
 		uint16_t incomingUnreliableSequenceNumber;
 		ENetList incomingReliableCommands;
 		ENetList incomingUnreliableCommands;
+		uint64_t scheduleFinish;
 	} ENetChannel;
 
+	/* State of the delay based congestion control: max delivery rate of recent rounds in bytes per second and min round trip time */
+	typedef struct _ENetDelayControl {
+		uint32_t bandwidth[ENET_PEER_DELAY_BANDWIDTH_ROUNDS];
+		uint32_t maximumBandwidth;
+		uint32_t minimumRoundTripTime;
+		uint32_t minimumRoundTripStamp;
+		uint64_t roundDelivered;
+		uint32_t roundStart;
+		uint32_t round;
+		uint32_t fullBandwidth;
+		uint32_t fullBandwidthRounds;
+		uint32_t cycleStart;
+		uint32_t probeStart;
+		uint8_t cycleIndex;
+		uint8_t mode;
+	} ENetDelayControl;
+
 	typedef struct _ENetPeer {
 		ENetListNode dispatchList;
 		struct _ENetHost* host;
@@ -609,6 +685,23 @@ extern "C" {
 		uint32_t unsequencedWindow[ENET_PEER_UNSEQUENCED_WINDOW_SIZE / 32];
 		uint32_t eventData;
 		size_t totalWaitingData;
+		size_t activeIndex;
+		uint32_t cookieData;
+		uint32_t cookieStart;
+		uint32_t cookieTime;
+		int cookiePending;
+		uint64_t scheduleTime;
+		int scheduleDirty;
+		uint64_t deliveredData;
+		uint64_t unreliableDataSent;
+		uint64_t unreliableDataDelivered;
+		uint32_t pacingRate;
+		uint64_t pacingTime;
+		int pacingLimited;
+		ENetOutgoingCommand** latestCommands;
+		size_t latestCapacity;
+		size_t latestCount;
+		ENetDelayControl delayControl;
 	} ENetPeer;
 
 	typedef enum _ENetEventType {
@@ -627,6 +720,35 @@ extern "C" {
 		ENetPacket* packet;
 	} ENetEvent;
 
+	typedef struct _ENetDatagram {
+		ENetAddress address;
+		int dataLength;
+		uint64_t sendTime;
+		uint8_t data[ENET_PROTOCOL_MAXIMUM_MTU];
+	} ENetDatagram;
+
+	/* Token bucket of one source address, tokens are in thousandths of a datagram */
+	typedef struct _ENetRateBucket {
+		uint32_t tag;
+		uint32_t time;
+		uint32_t tokens;
+	} ENetRateBucket;
+
+	/* Scheduling class of one channel, higher priority is sent first, weight is the share of bandwidth inside one priority */
+	typedef struct _ENetChannelSchedule {
+		uint8_t priority;
+		uint16_t weight;
+	} ENetChannelSchedule;
+
+	/* Congestion control of the peer send path: acknowledge takes every round trip sample, window bounds reliable data in transit,
+	   admit returns 0 to drop an unreliable packet, rate paces all data in bytes per second (NULL or 0 leave the peer unpaced) */
+	typedef struct _ENetCongestionControl {
+		void (ENET_CALLBACK* acknowledge)(ENetPeer* peer, uint32_t roundTripTime);
+		uint32_t (ENET_CALLBACK* window)(ENetPeer* peer);
+		int (ENET_CALLBACK* admit)(ENetPeer* peer);
+		uint32_t (ENET_CALLBACK* rate)(ENetPeer* peer);
+	} ENetCongestionControl;
+
 	typedef uint64_t(ENET_CALLBACK* ENetChecksumCallback)(const ENetBuffer* buffers, int bufferCount);
 
 	typedef int (ENET_CALLBACK* ENetInterceptCallback)(ENetEvent* event, ENetAddress* address, uint8_t* receivedData, int receivedDataLength);
@@ -643,8 +765,11 @@ extern "C" {
 		uint8_t preventConnections;
 		ENetPeer* peers;
 		size_t peerCount;
+		ENetPeer** activePeers;
+		size_t activePeerCount;
 		size_t channelLimit;
 		uint32_t serviceTime;
+		uint32_t serviceDeadline;
 		ENetList dispatchQueue;
 		int continueSending;
 		size_t packetSize;
@@ -653,6 +778,32 @@ extern "C" {
 		uint32_t totalSentPackets;
 		uint32_t totalReceivedData;
 		uint32_t totalReceivedPackets;
+		uint32_t totalReceiveCalls;
+		uint32_t totalSendCalls;
+		uint32_t totalReplacedCommands;
+		uint32_t totalCookieReplies;
+		uint32_t totalCookieRejects;
+		uint64_t totalCookieTime;
+		int cookies;
+		uint64_t cookieKey[2];
+		ENetRateBucket* rateTable;
+		size_t rateTableMask;
+		uint32_t rateLimit;
+		uint32_t rateCapacity;
+		uint32_t rateRefillTime;
+		uint64_t rateKey[2];
+		uint32_t totalLimitedPackets;
+		uint64_t totalLimitedData;
+		ENetChannelSchedule* channelSchedule;
+		ENetList* scheduleQueues;
+		size_t scheduleChannelCount;
+		uint32_t* queueDelay;
+		const ENetCongestionControl* congestionControl;
+		ENetPacing pacing;
+		uint64_t pacingTime;
+		uint64_t pacingCredit;
+		uint64_t pacingOffset;
+		uint64_t sendTime;
 		ENetProtocol commands[ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS];
 		size_t commandCount;
 		ENetBuffer buffers[ENET_BUFFER_MAXIMUM];
@@ -662,6 +813,13 @@ extern "C" {
 		ENetAddress receivedAddress;
 		uint8_t* receivedData;
 		size_t receivedDataLength;
+		ENetDatagram* receiveBatch;
+		size_t receiveBatchSize;
+		size_t receiveBatchCount;
+		size_t receiveBatchIndex;
+		ENetDatagram* sendBatch;
+		size_t sendBatchSize;
+		size_t sendBatchCount;
 		ENetInterceptCallback interceptCallback;
 		size_t connectedPeers;
 		size_t bandwidthLimitedPeers;
@@ -685,12 +843,14 @@ extern "C" {
 	ENET_API int enet_array_is_zeroed(const uint8_t*, int);
 	ENET_API uint32_t enet_time_get(void);
 	ENET_API uint64_t enet_crc64(const ENetBuffer*, int);
+	ENET_API uint64_t enet_crc32c(const ENetBuffer*, int);
 
 	ENET_API ENetPacket* enet_packet_create(const void*, size_t, uint32_t);
 	ENET_API ENetPacket* enet_packet_create_offset(const void*, size_t, size_t, uint32_t);
 	ENET_API void enet_packet_destroy(ENetPacket*);
 
 	ENET_API int enet_peer_send(ENetPeer*, uint8_t, ENetPacket*);
+	ENET_API int enet_peer_send_latest(ENetPeer*, uint8_t, ENetPacket*, uint32_t);
 	ENET_API ENetPacket* enet_peer_receive(ENetPeer*, uint8_t*);
 	ENET_API void enet_peer_ping(ENetPeer*);
 	ENET_API void enet_peer_ping_interval(ENetPeer*, uint32_t);
@@ -701,12 +861,13 @@ extern "C" {
 	ENET_API void enet_peer_disconnect_later(ENetPeer*, uint32_t);
 	ENET_API void enet_peer_throttle_configure(ENetPeer*, uint32_t, uint32_t, uint32_t, uint32_t);
 
-	ENET_API ENetHost* enet_host_create(const ENetAddress*, size_t, size_t, uint32_t, uint32_t, int);
+	ENET_API ENetHost* enet_host_create(const ENetAddress*, size_t, size_t, uint32_t, uint32_t, int, int);
 	ENET_API void enet_host_destroy(ENetHost*);
 	ENET_API void enet_host_prevent_connections(ENetHost*, uint8_t);
 	ENET_API ENetPeer* enet_host_connect(ENetHost*, const ENetAddress*, size_t, uint32_t);
 	ENET_API int enet_host_check_events(ENetHost*, ENetEvent*);
 	ENET_API int enet_host_service(ENetHost*, ENetEvent*, uint32_t);
+	ENET_API int enet_host_service_batch(ENetHost*, ENetEvent*, size_t);
 	ENET_API void enet_host_flush(ENetHost*);
 	ENET_API void enet_host_broadcast(ENetHost*, uint8_t, ENetPacket*);
 	ENET_API void enet_host_broadcast_exclude(ENetHost*, uint8_t, ENetPacket*, ENetPeer*);
@@ -726,7 +887,10 @@ extern "C" {
 	ENET_API ENetSocket enet_socket_accept(ENetSocket, ENetAddress*);
 	ENET_API int enet_socket_connect(ENetSocket, const ENetAddress*);
 	ENET_API int enet_socket_send(ENetSocket, const ENetAddress*, const ENetBuffer*, size_t);
+	ENET_API int enet_socket_send_at(ENetSocket, const ENetAddress*, const ENetBuffer*, size_t, uint64_t);
 	ENET_API int enet_socket_receive(ENetSocket, ENetAddress*, ENetBuffer*, size_t);
+	ENET_API int enet_socket_receive_batch(ENetSocket, ENetDatagram*, size_t, size_t);
+	ENET_API int enet_socket_send_batch(ENetSocket, const ENetDatagram*, size_t);
 	ENET_API int enet_socket_wait(ENetSocket, uint32_t*, uint64_t);
 	ENET_API int enet_socket_set_option(ENetSocket, ENetSocketOption, int);
 	ENET_API int enet_socket_get_option(ENetSocket, ENetSocketOption, int*);
@@ -748,9 +912,29 @@ extern "C" {
 	ENET_API uint32_t enet_host_get_packets_received(const ENetHost*);
 	ENET_API uint32_t enet_host_get_bytes_sent(const ENetHost*);
 	ENET_API uint32_t enet_host_get_bytes_received(const ENetHost*);
+	ENET_API uint32_t enet_host_get_receive_calls(const ENetHost*);
+	ENET_API uint32_t enet_host_get_send_calls(const ENetHost*);
+	ENET_API uint32_t enet_host_get_replaced_commands(const ENetHost*);
+	ENET_API uint32_t enet_host_get_cookie_replies(const ENetHost*);
+	ENET_API uint32_t enet_host_get_cookie_rejects(const ENetHost*);
+	ENET_API uint64_t enet_host_get_cookie_time(const ENetHost*);
+	ENET_API uint32_t enet_host_get_limited_packets(const ENetHost*);
+	ENET_API uint64_t enet_host_get_limited_bytes(const ENetHost*);
+	ENET_API const uint32_t* enet_host_get_queue_delay(const ENetHost*, uint8_t);
+	ENET_API uint32_t enet_host_get_service_deadline(const ENetHost*);
+	ENET_API size_t enet_host_get_pending_events(ENetHost*);
 	ENET_API void enet_host_set_max_duplicate_peers(ENetHost*, uint16_t);
 	ENET_API void enet_host_set_intercept_callback(ENetHost*, ENetInterceptCallback);
 	ENET_API void enet_host_set_checksum_callback(ENetHost*, ENetChecksumCallback);
+	ENET_API int enet_host_set_receive_batch(ENetHost*, size_t);
+	ENET_API int enet_host_set_send_batch(ENetHost*, size_t);
+	ENET_API void enet_host_set_cookies(ENetHost*, uint64_t, uint64_t);
+	ENET_API int enet_host_set_rate_limit(ENetHost*, uint32_t, uint32_t, size_t, uint64_t, uint64_t);
+	ENET_API int enet_host_set_channel_schedule(ENetHost*, const ENetChannelSchedule*, size_t);
+	ENET_API void enet_host_set_congestion_control(ENetHost*, const ENetCongestionControl*);
+	ENET_API const ENetCongestionControl* enet_congestion_throttle(void);
+	ENET_API const ENetCongestionControl* enet_congestion_delay(void);
+	ENET_API int enet_host_set_pacing(ENetHost*, ENetPacing);
 
 	ENET_API uint32_t enet_peer_get_id(const ENetPeer*);
 	ENET_API int enet_peer_get_ip(const ENetPeer*, char*, size_t);
@@ -764,6 +948,7 @@ extern "C" {
 	ENET_API uint64_t enet_peer_get_packets_sent(const ENetPeer*);
 	ENET_API uint64_t enet_peer_get_packets_lost(const ENetPeer*);
 	ENET_API float enet_peer_get_packets_throttle(const ENetPeer*);
+	ENET_API uint32_t enet_peer_get_pacing_rate(const ENetPeer*);
 	ENET_API uint64_t enet_peer_get_bytes_sent(const ENetPeer*);
 	ENET_API uint64_t enet_peer_get_bytes_received(const ENetPeer*);
 	ENET_API void* enet_peer_get_data(const ENetPeer*);
@@ -778,9 +963,23 @@ extern "C" {
 	*/
 
 	extern void enet_host_bandwidth_throttle(ENetHost*);
+	extern void enet_host_activate_peer(ENetHost*, ENetPeer*);
+	extern void enet_host_deactivate_peer(ENetHost*, ENetPeer*);
 	extern uint64_t enet_host_random_seed(void);
+	extern uint64_t enet_time_get_ns(void);
+	extern uint64_t enet_time_get_txtime(void);
+	extern uint64_t enet_siphash(const uint64_t*, const uint8_t*, size_t);
+	extern uint32_t enet_crc32c_update(uint32_t, const uint8_t*, size_t);
 
 	extern int enet_peer_throttle(ENetPeer*, uint32_t);
+	extern void enet_peer_throttle_acknowledge(ENetPeer*, uint32_t);
+	extern uint32_t enet_peer_throttle_window(ENetPeer*);
+	extern int enet_peer_throttle_admit(ENetPeer*);
+	extern void enet_peer_delay_acknowledge(ENetPeer*, uint32_t);
+	extern uint32_t enet_peer_delay_window(ENetPeer*);
+	extern int enet_peer_delay_admit(ENetPeer*);
+	extern uint32_t enet_peer_delay_rate(ENetPeer*);
+	extern uint32_t enet_peer_delay_product(const ENetPeer*, uint32_t);
 	extern void enet_peer_reset_queues(ENetPeer*);
 	extern void enet_peer_setup_outgoing_command(ENetPeer*, ENetOutgoingCommand*);
 	extern ENetOutgoingCommand* enet_peer_queue_outgoing_command(ENetPeer*, const ENetProtocol*, ENetPacket*, uint32_t, uint16_t);
@@ -790,8 +989,25 @@ extern "C" {
 	extern void enet_peer_dispatch_incoming_reliable_commands(ENetPeer*, ENetChannel*, ENetIncomingCommand*);
 	extern void enet_peer_on_connect(ENetPeer*);
 	extern void enet_peer_on_disconnect(ENetPeer*);
+	extern void enet_peer_queue_connect(ENetPeer*, uint32_t);
+	extern size_t enet_peer_latest_slot(const ENetPeer*, uint8_t, uint32_t);
+	extern ENetOutgoingCommand** enet_peer_find_latest(ENetPeer*, uint8_t, uint32_t);
+	extern int enet_peer_index_latest(ENetPeer*, ENetOutgoingCommand*);
+	extern void enet_peer_remove_latest(ENetPeer*, const ENetOutgoingCommand*);
 
 	extern size_t enet_protocol_command_size(uint8_t);
+	extern int enet_protocol_receive_datagram(ENetHost*);
+	extern int enet_protocol_send_datagram(ENetHost*, ENetPeer*);
+	extern int enet_protocol_flush_datagrams(ENetHost*);
+	extern void enet_protocol_update_service_deadline(ENetHost*);
+	extern uint32_t enet_protocol_cookie(const ENetHost*, const ENetAddress*, uint32_t, const uint8_t*);
+	extern void enet_protocol_cookie_attempt(const ENetPeer*, uint8_t*);
+	extern int enet_protocol_send_cookie_request(ENetHost*, ENetPeer*);
+	extern int enet_protocol_handle_cookie(ENetHost*);
+	extern int enet_protocol_rate_limit(ENetHost*);
+	extern void enet_protocol_schedule_outgoing_commands(ENetHost*, ENetPeer*);
+	extern void enet_protocol_charge_outgoing_command(ENetHost*, ENetPeer*, const ENetOutgoingCommand*, uint64_t);
+	extern int enet_protocol_pace_outgoing_commands(ENetHost*, ENetPeer*);
 
 #ifdef __cplusplus
 }
@@ -1239,6 +1455,27 @@ inline uint32_t enet_time_get(void) {
 	return (uint32_t)(result_in_ns / ns_in_ms);
 }
 
+inline uint64_t enet_time_get_ns(void) {
+	struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC_RAW
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+#else
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+
+	return ts.tv_nsec + (uint64_t)ts.tv_sec * 1000 * 1000 * 1000;
+}
+
+/* Clock of SO_TXTIME departure times, kernel does not accept the raw clock */
+inline uint64_t enet_time_get_txtime(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_nsec + (uint64_t)ts.tv_sec * 1000 * 1000 * 1000;
+}
+
 /*
 =======================================================================
 
@@ -1397,6 +1634,201 @@ inline uint64_t enet_crc64(const ENetBuffer* buffers, int bufferCount) {
 	return ENET_HOST_TO_NET_64(~crc);
 }
 
+/* CRC32C (Castagnoli), crc32 instruction when the CPU has it, slicing-by-8 otherwise */
+typedef struct _ENetCrc32cTable {
+	uint32_t data[8][256];
+} ENetCrc32cTable;
+
+inline constexpr ENetCrc32cTable enet_crc32c_table_create(void) {
+	ENetCrc32cTable table{};
+
+	for(uint32_t index = 0; index < 256; ++index) {
+		uint32_t crc = index;
+
+		for(int bit = 0; bit < 8; ++bit) {
+			crc = crc & 1 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+		}
+
+		table.data[0][index] = crc;
+	}
+
+	for(uint32_t index = 0; index < 256; ++index) {
+		for(int slice = 1; slice < 8; ++slice) {
+			const uint32_t crc = table.data[slice - 1][index];
+			table.data[slice][index] = (crc >> 8) ^ table.data[0][crc & 0xFF];
+		}
+	}
+
+	return table;
+}
+
+inline constexpr ENetCrc32cTable crc32cTable = enet_crc32c_table_create();
+
+inline uint32_t enet_crc32c_update(uint32_t crc, const uint8_t* data, size_t dataLength) {
+	const uint32_t (*table)[256] = crc32cTable.data;
+
+	for(; dataLength >= 8; data += 8, dataLength -= 8) {
+		const uint32_t low = crc ^ ((uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24);
+		const uint32_t high = (uint32_t)data[4] | (uint32_t)data[5] << 8 | (uint32_t)data[6] << 16 | (uint32_t)data[7] << 24;
+
+		crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+			table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^ table[0][high >> 24];
+	}
+
+	while(dataLength-- > 0) {
+		crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xFF];
+	}
+
+	return crc;
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ENET_CRC32C_HARDWARE
+
+__attribute__((target("sse4.2"))) inline uint32_t enet_crc32c_update_hardware(uint32_t crc, const uint8_t* data, size_t dataLength) {
+	uint64_t crc64 = crc;
+
+	for(; dataLength >= 8; data += 8, dataLength -= 8) {
+		uint64_t value;
+		memcpy(&value, data, sizeof(value));
+		crc64 = _mm_crc32_u64(crc64, value);
+	}
+
+	crc = (uint32_t)crc64;
+
+	while(dataLength-- > 0) {
+		crc = _mm_crc32_u8(crc, *data++);
+	}
+
+	return crc;
+}
+
+inline int enet_crc32c_hardware_supported(void) {
+	return __builtin_cpu_supports("sse4.2");
+}
+#elif defined(_M_X64)
+#define ENET_CRC32C_HARDWARE
+
+inline uint32_t enet_crc32c_update_hardware(uint32_t crc, const uint8_t* data, size_t dataLength) {
+	uint64_t crc64 = crc;
+
+	for(; dataLength >= 8; data += 8, dataLength -= 8) {
+		uint64_t value;
+		memcpy(&value, data, sizeof(value));
+		crc64 = _mm_crc32_u64(crc64, value);
+	}
+
+	crc = (uint32_t)crc64;
+
+	while(dataLength-- > 0) {
+		crc = _mm_crc32_u8(crc, *data++);
+	}
+
+	return crc;
+}
+
+inline int enet_crc32c_hardware_supported(void) {
+	int info[4];
+	__cpuid(info, 1);
+
+	return (info[2] >> 20) & 1;
+}
+#elif defined(__ARM_FEATURE_CRC32)
+#define ENET_CRC32C_HARDWARE
+
+inline uint32_t enet_crc32c_update_hardware(uint32_t crc, const uint8_t* data, size_t dataLength) {
+	for(; dataLength >= 8; data += 8, dataLength -= 8) {
+		uint64_t value;
+		memcpy(&value, data, sizeof(value));
+		crc = __crc32cd(crc, value);
+	}
+
+	while(dataLength-- > 0) {
+		crc = __crc32cb(crc, *data++);
+	}
+
+	return crc;
+}
+
+inline int enet_crc32c_hardware_supported(void) {
+	return 1;
+}
+#endif
+
+inline uint64_t enet_crc32c(const ENetBuffer* buffers, int bufferCount) {
+	uint32_t crc = 0xFFFFFFFF;
+
+#ifdef ENET_CRC32C_HARDWARE
+	static const int hardware = enet_crc32c_hardware_supported();
+#endif
+
+	while(bufferCount-- > 0) {
+#ifdef ENET_CRC32C_HARDWARE
+		if(hardware)
+			crc = enet_crc32c_update_hardware(crc, (const uint8_t*)buffers->data, buffers->dataLength);
+		else
+#endif
+			crc = enet_crc32c_update(crc, (const uint8_t*)buffers->data, buffers->dataLength);
+
+		++buffers;
+	}
+
+	return ENET_HOST_TO_NET_64((uint64_t)~crc);
+}
+
+/* SipHash-2-4, keyed hash for connection cookies */
+#define ENET_SIPHASH_ROTATE(x, b) (uint64_t)(((x) << (b)) | ((x) >> (64 - (b))))
+
+inline void enet_siphash_round(uint64_t* v) {
+	v[0] += v[1];
+	v[1] = ENET_SIPHASH_ROTATE(v[1], 13) ^ v[0];
+	v[0] = ENET_SIPHASH_ROTATE(v[0], 32);
+	v[2] += v[3];
+	v[3] = ENET_SIPHASH_ROTATE(v[3], 16) ^ v[2];
+	v[0] += v[3];
+	v[3] = ENET_SIPHASH_ROTATE(v[3], 21) ^ v[0];
+	v[2] += v[1];
+	v[1] = ENET_SIPHASH_ROTATE(v[1], 17) ^ v[2];
+	v[2] = ENET_SIPHASH_ROTATE(v[2], 32);
+}
+
+inline uint64_t enet_siphash(const uint64_t* key, const uint8_t* data, size_t dataLength) {
+	uint64_t v[4] = {
+		key[0] ^ UINT64_C(0x736f6d6570736575), key[1] ^ UINT64_C(0x646f72616e646f6d),
+		key[0] ^ UINT64_C(0x6c7967656e657261), key[1] ^ UINT64_C(0x7465646279746573)
+	};
+
+	uint64_t block;
+	size_t offset, index;
+
+	for(offset = 0; offset + 8 <= dataLength; offset += 8) {
+		for(block = 0, index = 0; index < 8; ++index) {
+			block |= (uint64_t)data[offset + index] << (index * 8);
+		}
+
+		v[3] ^= block;
+		enet_siphash_round(v);
+		enet_siphash_round(v);
+		v[0] ^= block;
+	}
+
+	for(block = (uint64_t)dataLength << 56, index = 0; offset + index < dataLength; ++index) {
+		block |= (uint64_t)data[offset + index] << (index * 8);
+	}
+
+	v[3] ^= block;
+	enet_siphash_round(v);
+	enet_siphash_round(v);
+	v[0] ^= block;
+	v[2] ^= 0xFF;
+
+	for(index = 0; index < 4; ++index) {
+		enet_siphash_round(v);
+	}
+
+	return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
 /*
 =======================================================================
 
@@ -1712,6 +2144,16 @@ inline ENetProtocolCommand enet_protocol_remove_sent_reliable_command(ENetPeer*
 
 	commandNumber = (ENetProtocolCommand)(outgoingCommand->command.header.command & ENET_PROTOCOL_COMMAND_MASK);
 
+	/* Unreliable data sent before an acknowledged command is taken as delivered, it has no acknowledgements of its own */
+	if(wasSent) {
+		peer->deliveredData += outgoingCommand->fragmentLength;
+
+		if(outgoingCommand->sentData > peer->unreliableDataDelivered) {
+			peer->deliveredData += outgoingCommand->sentData - peer->unreliableDataDelivered;
+			peer->unreliableDataDelivered = outgoingCommand->sentData;
+		}
+	}
+
 	enet_list_remove(&outgoingCommand->outgoingCommandList);
 
 	if(outgoingCommand->packet != NULL) {
@@ -1775,6 +2217,7 @@ inline ENetPeer* enet_protocol_handle_connect(ENetHost* host, ENetProtocolHeader
 
 	peer->channelCount = channelCount;
 	peer->state = ENET_PEER_STATE_ACKNOWLEDGING_CONNECT;
+	enet_host_activate_peer(host, peer);
 	peer->connectID = command->connect.connectID;
 	peer->address = host->receivedAddress;
 	peer->outgoingPeerID = ENET_NET_TO_HOST_16(command->connect.outgoingPeerID);
@@ -1809,6 +2252,7 @@ inline ENetPeer* enet_protocol_handle_connect(ENetHost* host, ENetProtocolHeader
 		enet_list_clear(&channel->incomingUnreliableCommands);
 
 		channel->usedReliableWindows = 0;
+		channel->scheduleFinish = 0;
 
 		memset(channel->reliableWindows, 0, sizeof(channel->reliableWindows));
 	}
@@ -2217,7 +2661,11 @@ inline int enet_protocol_handle_acknowledge(ENetHost* host, ENetEvent* event, EN
 	if(roundTripTime == 0)
 		roundTripTime = 1;
 
-	enet_peer_throttle(peer, roundTripTime);
+	/* Removed first, controller sees the data delivered by this acknowledgement */
+	receivedReliableSequenceNumber = ENET_NET_TO_HOST_16(command->acknowledge.receivedReliableSequenceNumber);
+	commandNumber = enet_protocol_remove_sent_reliable_command(peer, receivedReliableSequenceNumber, command->header.channelID);
+
+	host->congestionControl->acknowledge(peer, roundTripTime);
 
 	if(peer->lastReceiveTime > 0) {
 		if(roundTripTime >= peer->roundTripTime) {
@@ -2260,9 +2708,6 @@ inline int enet_protocol_handle_acknowledge(ENetHost* host, ENetEvent* event, EN
 	peer->lastReceiveTime = ENET_MAX(host->serviceTime, 1);
 	peer->earliestTimeout = 0;
 
-	receivedReliableSequenceNumber = ENET_NET_TO_HOST_16(command->acknowledge.receivedReliableSequenceNumber);
-	commandNumber = enet_protocol_remove_sent_reliable_command(peer, receivedReliableSequenceNumber, command->header.channelID);
-
 	switch(peer->state) {
 		case ENET_PEER_STATE_ACKNOWLEDGING_CONNECT:
 			if(commandNumber != ENET_PROTOCOL_COMMAND_VERIFY_CONNECT)
@@ -2384,10 +2829,12 @@ inline int enet_protocol_handle_incoming_commands(ENetHost* host, ENetEvent* eve
 	}
 
 	if(host->checksumCallback != NULL) {
-		enet_checksum* checksum = (enet_checksum*)&host->receivedData[headerSize - sizeof(enet_checksum)];
-		enet_checksum desiredChecksum = *checksum;
+		/* Checksum follows the 2 or 4 byte header, accessed with memcpy */
+		uint8_t* checksum = &host->receivedData[headerSize - sizeof(enet_checksum)];
+		enet_checksum desiredChecksum, seedChecksum = peer != NULL ? peer->connectID : 0;
 		ENetBuffer buffer;
-		*checksum = peer != NULL ? peer->connectID : 0;
+		memcpy(&desiredChecksum, checksum, sizeof(enet_checksum));
+		memcpy(checksum, &seedChecksum, sizeof(enet_checksum));
 		buffer.data = host->receivedData;
 		buffer.dataLength = host->receivedDataLength;
 
@@ -2550,15 +2997,52 @@ commandError:
 	return 0;
 }
 
-inline int enet_protocol_receive_incoming_commands(ENetHost* host, ENetEvent* event) {
-	int packets;
+inline int enet_protocol_receive_datagram(ENetHost* host) {
+	ENetDatagram* datagram;
 
-	for(packets = 0; packets < 256; ++packets) {
+	if(host->receiveBatch == NULL) {
 		int receivedLength;
 		ENetBuffer buffer;
 		buffer.data = host->packetData[0];
 		buffer.dataLength = host->mtu;
 		receivedLength = enet_socket_receive(host->socket, &host->receivedAddress, &buffer, 1);
+		host->totalReceiveCalls++;
+
+		if(receivedLength > 0)
+			host->receivedData = host->packetData[0];
+
+		return receivedLength;
+	}
+
+	/* Datagrams left in the batch are drained before the next syscall */
+	if(host->receiveBatchIndex == host->receiveBatchCount) {
+		int datagramCount;
+		host->receiveBatchIndex = 0;
+		host->receiveBatchCount = 0;
+		datagramCount = enet_socket_receive_batch(host->socket, host->receiveBatch, host->receiveBatchSize, host->mtu);
+		host->totalReceiveCalls++;
+
+		if(datagramCount <= 0)
+			return datagramCount;
+
+		host->receiveBatchCount = datagramCount;
+	}
+
+	datagram = &host->receiveBatch[host->receiveBatchIndex++];
+
+	if(datagram->dataLength > 0) {
+		host->receivedAddress = datagram->address;
+		host->receivedData = datagram->data;
+	}
+
+	return datagram->dataLength;
+}
+
+inline int enet_protocol_receive_incoming_commands(ENetHost* host, ENetEvent* event) {
+	int packets;
+
+	for(packets = 0; packets < 256; ++packets) {
+		int receivedLength = enet_protocol_receive_datagram(host);
 
 		if(receivedLength == -2)
 			continue;
@@ -2569,11 +3053,16 @@ inline int enet_protocol_receive_incoming_commands(ENetHost* host, ENetEvent* ev
 		if(receivedLength == 0)
 			return 0;
 
-		host->receivedData = host->packetData[0];
 		host->receivedDataLength = receivedLength;
 		host->totalReceivedData += receivedLength;
 		host->totalReceivedPackets++;
 
+		if(host->rateTable != NULL && enet_protocol_rate_limit(host))
+			continue;
+
+		if(host->cookies != 0 && enet_protocol_handle_cookie(host))
+			continue;
+
 		if(host->interceptCallback != NULL) {
 			switch(host->interceptCallback(event, &host->receivedAddress, host->receivedData, host->receivedDataLength)) {
 				case 1:
@@ -2686,6 +3175,93 @@ inline int enet_protocol_check_timeouts(ENetHost* host, ENetPeer* peer, ENetEven
 	return 0;
 }
 
+/* Start-time fair queuing of channels: commands keep their order inside a channel, across channels the queue is ordered by
+   priority and then by virtual start time, a channel advances by size / weight per sent command.
+   Merged only after commands were queued, sending keeps the merged order, the merge only visits channels with queued commands */
+inline void enet_protocol_schedule_outgoing_commands(ENetHost* host, ENetPeer* peer) {
+	ENetList* queues = host->scheduleQueues;
+	ENetListIterator currentCommand;
+	uint64_t startTimes[ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT];
+	uint8_t activeChannels[ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT];
+	size_t channelCount = ENET_MIN(peer->channelCount, host->scheduleChannelCount), channelID, activeCount = 0, activeIndex, bestIndex;
+
+	if(!peer->scheduleDirty)
+		return;
+
+	peer->scheduleDirty = 0;
+
+	if(enet_list_empty(&peer->outgoingCommands) || enet_list_next(enet_list_begin(&peer->outgoingCommands)) == enet_list_end(&peer->outgoingCommands))
+		return;
+
+	for(channelID = 0; channelID < channelCount; ++channelID)
+		enet_list_clear(&queues[channelID]);
+
+	/* Control commands and unscheduled channels stay in front */
+	for(currentCommand = enet_list_begin(&peer->outgoingCommands); currentCommand != enet_list_end(&peer->outgoingCommands);) {
+		ENetOutgoingCommand* outgoingCommand = (ENetOutgoingCommand*)currentCommand;
+		currentCommand = enet_list_next(currentCommand);
+		channelID = outgoingCommand->command.header.channelID;
+
+		if(channelID < channelCount) {
+			if(enet_list_empty(&queues[channelID])) {
+				activeChannels[activeCount++] = (uint8_t)channelID;
+				startTimes[channelID] = ENET_MAX(peer->channels[channelID].scheduleFinish, peer->scheduleTime);
+			}
+
+			enet_list_insert(enet_list_end(&queues[channelID]), enet_list_remove(&outgoingCommand->outgoingCommandList));
+		}
+	}
+
+	while(activeCount > 0) {
+		ENetOutgoingCommand* outgoingCommand;
+		size_t bestChannel = activeChannels[0];
+		bestIndex = 0;
+
+		for(activeIndex = 1; activeIndex < activeCount; ++activeIndex) {
+			channelID = activeChannels[activeIndex];
+
+			/* Ties go to the lower channel, order of the active list changes on removal */
+			if(host->channelSchedule[channelID].priority > host->channelSchedule[bestChannel].priority || (host->channelSchedule[channelID].priority == host->channelSchedule[bestChannel].priority && (startTimes[channelID] < startTimes[bestChannel] || (startTimes[channelID] == startTimes[bestChannel] && channelID < bestChannel)))) {
+				bestChannel = channelID;
+				bestIndex = activeIndex;
+			}
+		}
+
+		outgoingCommand = (ENetOutgoingCommand*)enet_list_front(&queues[bestChannel]);
+		startTimes[bestChannel] += (uint64_t)(enet_protocol_command_size(outgoingCommand->command.header.command) + outgoingCommand->fragmentLength) * ENET_PEER_SCHEDULE_SCALE / host->channelSchedule[bestChannel].weight;
+		enet_list_insert(enet_list_end(&peer->outgoingCommands), enet_list_remove(&outgoingCommand->outgoingCommandList));
+
+		if(enet_list_empty(&queues[bestChannel]))
+			activeChannels[bestIndex] = activeChannels[--activeCount];
+	}
+}
+
+/* Advances virtual time of the channel and records time spent in the queue by first send */
+inline void enet_protocol_charge_outgoing_command(ENetHost* host, ENetPeer* peer, const ENetOutgoingCommand* outgoingCommand, uint64_t time) {
+	size_t channelID = outgoingCommand->command.header.channelID;
+	uint64_t delay, startTime;
+	size_t bucket = 0;
+
+	if(channelID >= ENET_MIN(peer->channelCount, host->scheduleChannelCount))
+		return;
+
+	startTime = ENET_MAX(peer->channels[channelID].scheduleFinish, peer->scheduleTime);
+	peer->scheduleTime = startTime;
+	peer->channels[channelID].scheduleFinish = startTime + (uint64_t)(enet_protocol_command_size(outgoingCommand->command.header.command) + outgoingCommand->fragmentLength) * ENET_PEER_SCHEDULE_SCALE / host->channelSchedule[channelID].weight;
+
+	if(outgoingCommand->sendAttempts > 1)
+		return;
+
+	delay = time > outgoingCommand->queueTime ? (time - outgoingCommand->queueTime) / 1000 : 0;
+
+	while(delay > 0 && bucket < ENET_HOST_QUEUE_DELAY_BUCKETS - 1) {
+		delay >>= 1;
+		++bucket;
+	}
+
+	++host->queueDelay[channelID * ENET_HOST_QUEUE_DELAY_BUCKETS + bucket];
+}
+
 inline int enet_protocol_check_outgoing_commands(ENetHost* host, ENetPeer* peer) {
 	ENetProtocol* command = &host->commands[host->commandCount];
 	ENetBuffer* buffer = &host->buffers[host->bufferCount];
@@ -2694,12 +3270,33 @@ inline int enet_protocol_check_outgoing_commands(ENetHost* host, ENetPeer* peer)
 	ENetChannel* channel = NULL;
 	uint16_t reliableWindow = 0;
 	size_t commandSize = 0;
-	int windowExceeded = 0, windowWrap = 0, canPing = 1;
+	int windowExceeded = 0, windowWrap = 0, canPing = 1, holdLimited = 0;
+	uint64_t time = 0, departureLimit = 0;
+
+	if(host->channelSchedule != NULL) {
+		enet_protocol_schedule_outgoing_commands(host, peer);
+		time = enet_time_get_ns();
+	}
+
+	if(host->congestionControl->rate != NULL || host->pacing != ENET_PACING_NONE) {
+		holdLimited = enet_protocol_pace_outgoing_commands(host, peer);
+		departureLimit = host->pacingTime + (host->pacing == ENET_PACING_TXTIME ? ENET_PEER_PACING_BURST * UINT64_C(1000000) : 0);
+	}
+
+	peer->pacingLimited = 0;
 	currentCommand = enet_list_begin(&peer->outgoingCommands);
 
 	while(currentCommand != enet_list_end(&peer->outgoingCommands)) {
 		outgoingCommand = (ENetOutgoingCommand*)currentCommand;
 
+		/* Data waits for its departure time, control commands are never held back and the own estimate of the host holds no longer than a burst */
+		if(outgoingCommand->packet != NULL && peer->pacingRate != 0 && peer->pacingTime > departureLimit && (!holdLimited || outgoingCommand->queueTime + ENET_PEER_PACING_BURST * UINT64_C(1000000) > host->pacingTime)) {
+			peer->pacingLimited = 1;
+			currentCommand = enet_list_next(currentCommand);
+
+			continue;
+		}
+
 		if(outgoingCommand->command.header.command & ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE) {
 			channel = outgoingCommand->command.header.channelID < peer->channelCount ? &peer->channels[outgoingCommand->command.header.channelID] : NULL;
 			reliableWindow = outgoingCommand->reliableSequenceNumber / ENET_PEER_RELIABLE_WINDOW_SIZE;
@@ -2717,7 +3314,7 @@ inline int enet_protocol_check_outgoing_commands(ENetHost* host, ENetPeer* peer)
 
 			if(outgoingCommand->packet != NULL) {
 				if(!windowExceeded) {
-					uint32_t windowSize = (peer->packetThrottle * peer->windowSize) / ENET_PEER_PACKET_THROTTLE_SCALE;
+					uint32_t windowSize = host->congestionControl->window(peer);
 
 					if(peer->reliableDataInTransit + outgoingCommand->fragmentLength > ENET_MAX(windowSize, peer->mtu))
 						windowExceeded = 1;
@@ -2763,14 +3360,12 @@ inline int enet_protocol_check_outgoing_commands(ENetHost* host, ENetPeer* peer)
 				enet_list_remove(&outgoingCommand->outgoingCommandList));
 
 			outgoingCommand->sentTime = host->serviceTime;
+			outgoingCommand->sentData = peer->unreliableDataSent;
 			host->headerFlags |= ENET_PROTOCOL_HEADER_FLAG_SENT_TIME;
 			peer->reliableDataInTransit += outgoingCommand->fragmentLength;
 		} else {
 			if(outgoingCommand->packet != NULL && outgoingCommand->fragmentOffset == 0 && !(outgoingCommand->packet->flags & (ENET_PACKET_FLAG_UNTHROTTLED))) {
-				peer->packetThrottleCounter += ENET_PEER_PACKET_THROTTLE_COUNTER;
-				peer->packetThrottleCounter %= ENET_PEER_PACKET_THROTTLE_SCALE;
-
-				if(peer->packetThrottleCounter > peer->packetThrottle) {
+				if(!host->congestionControl->admit(peer)) {
 					uint16_t reliableSequenceNumber = outgoingCommand->reliableSequenceNumber,
 
 						unreliableSequenceNumber = outgoingCommand->unreliableSequenceNumber;
@@ -2781,6 +3376,9 @@ inline int enet_protocol_check_outgoing_commands(ENetHost* host, ENetPeer* peer)
 						if(outgoingCommand->packet->referenceCount == 0)
 							enet_packet_destroy(outgoingCommand->packet);
 
+						if(outgoingCommand->replaceKey != 0)
+							enet_peer_remove_latest(peer, outgoingCommand);
+
 						enet_list_remove(&outgoingCommand->outgoingCommandList);
 						enet_free(outgoingCommand);
 
@@ -2801,8 +3399,24 @@ inline int enet_protocol_check_outgoing_commands(ENetHost* host, ENetPeer* peer)
 
 			enet_list_remove(&outgoingCommand->outgoingCommandList);
 
-			if(outgoingCommand->packet != NULL)
+			if(outgoingCommand->replaceKey != 0)
+				enet_peer_remove_latest(peer, outgoingCommand);
+
+			if(outgoingCommand->packet != NULL) {
 				enet_list_insert(enet_list_end(&peer->sentUnreliableCommands), outgoingCommand);
+				peer->unreliableDataSent += outgoingCommand->fragmentLength;
+			}
+		}
+
+		if(host->channelSchedule != NULL)
+			enet_protocol_charge_outgoing_command(host, peer, outgoingCommand, time);
+
+		/* Datagram leaves at the departure time of its first paced command */
+		if(outgoingCommand->packet != NULL && peer->pacingRate != 0) {
+			if(host->pacing == ENET_PACING_TXTIME && host->sendTime == 0 && peer->pacingTime > host->pacingTime)
+				host->sendTime = peer->pacingTime + host->pacingOffset;
+
+			peer->pacingTime += (uint64_t)(commandSize + outgoingCommand->fragmentLength) * 1000000000 / peer->pacingRate;
 		}
 
 		buffer->data = command;
@@ -2833,22 +3447,110 @@ inline int enet_protocol_check_outgoing_commands(ENetHost* host, ENetPeer* peer)
 	return canPing;
 }
 
+inline int enet_protocol_flush_datagrams(ENetHost* host) {
+	size_t sentCount = 0;
+
+	while(sentCount < host->sendBatchCount) {
+		int batchCount = enet_socket_send_batch(host->socket, &host->sendBatch[sentCount], host->sendBatchCount - sentCount);
+		host->totalSendCalls++;
+
+		if(batchCount < 0) {
+			host->sendBatchCount = 0;
+
+			return -1;
+		}
+
+		/* Socket buffer is full, the rest is dropped like a single send would do */
+		if(batchCount == 0)
+			break;
+
+		sentCount += batchCount;
+	}
+
+	host->sendBatchCount = 0;
+
+	return 0;
+}
+
+inline int enet_protocol_send_datagram(ENetHost* host, ENetPeer* peer) {
+	ENetDatagram* datagram;
+	ENetBuffer* buffer;
+	size_t dataLength = 0;
+
+	if(host->sendBatch == NULL) {
+		host->totalSendCalls++;
+
+		return enet_socket_send_at(host->socket, &peer->address, host->buffers, host->bufferCount, host->sendTime);
+	}
+
+	/* Assembled buffers may point into packets released right after the send, so they are copied */
+	datagram = &host->sendBatch[host->sendBatchCount];
+	datagram->address = peer->address;
+	datagram->sendTime = host->sendTime;
+
+	for(buffer = host->buffers; buffer < &host->buffers[host->bufferCount]; ++buffer) {
+		if(dataLength + buffer->dataLength > sizeof(datagram->data))
+			return -1;
+
+		memcpy(&datagram->data[dataLength], buffer->data, buffer->dataLength);
+		dataLength += buffer->dataLength;
+	}
+
+	datagram->dataLength = (int)dataLength;
+
+	if(++host->sendBatchCount == host->sendBatchSize && enet_protocol_flush_datagrams(host) < 0)
+		return -1;
+
+	return (int)dataLength;
+}
+
 inline int enet_protocol_send_outgoing_commands(ENetHost* host, ENetEvent* event, int checkForTimeouts) {
 	uint8_t headerData[sizeof(ENetProtocolHeader) + sizeof(enet_checksum)];
 	ENetProtocolHeader* header = (ENetProtocolHeader*)headerData;
 	ENetPeer* currentPeer;
+	size_t activeIndex;
 	int sentLength;
 	host->continueSending = 1;
+	host->serviceDeadline = host->serviceTime;
+
+	/* Paced data may catch up the time since the previous pass, kernel pacing schedules ahead instead */
+	if(host->congestionControl->rate != NULL || host->pacing != ENET_PACING_NONE) {
+		uint64_t time = enet_time_get_ns();
+		host->pacingCredit = host->pacing == ENET_PACING_TXTIME ? 0 : ENET_MIN(time - host->pacingTime, ENET_PEER_PACING_BURST * UINT64_C(1000000));
+		host->pacingCredit = ENET_MAX(host->pacingCredit, ENET_PEER_PACING_QUANTUM * UINT64_C(1000000));
+		host->pacingTime = time;
+
+		if(host->pacing == ENET_PACING_TXTIME)
+			host->pacingOffset = enet_time_get_txtime() - time;
+	}
 
 	while(host->continueSending) {
-		for(host->continueSending = 0, currentPeer = host->peers; currentPeer < &host->peers[host->peerCount]; ++currentPeer) {
+		/* Walk active peers from the end, reset of current peer moves an already visited one into its place */
+		for(host->continueSending = 0, activeIndex = host->activePeerCount; activeIndex-- > 0;) {
+			currentPeer = host->activePeers[activeIndex];
+
 			if(currentPeer->state == ENET_PEER_STATE_DISCONNECTED || currentPeer->state == ENET_PEER_STATE_ZOMBIE)
 				continue;
 
+			/* Connect is held back until the server answers with a cookie */
+			if(currentPeer->cookiePending) {
+				if(ENET_TIME_DIFFERENCE(host->serviceTime, currentPeer->cookieStart) >= currentPeer->timeoutMaximum) {
+					enet_protocol_notify_disconnect_timeout(host, currentPeer, event);
+
+					if(event != NULL && event->type != ENET_EVENT_TYPE_NONE)
+						return enet_protocol_flush_datagrams(host) < 0 ? -1 : 1;
+				} else if(ENET_TIME_DIFFERENCE(host->serviceTime, currentPeer->cookieTime) >= ENET_HOST_COOKIE_RETRY) {
+					enet_protocol_send_cookie_request(host, currentPeer);
+				}
+
+				continue;
+			}
+
 			host->headerFlags = 0;
 			host->commandCount = 0;
 			host->bufferCount = 1;
 			host->packetSize = sizeof(ENetProtocolHeader);
+			host->sendTime = 0;
 
 			if(host->checksumCallback != NULL)
 				host->packetSize += sizeof(enet_checksum);
@@ -2858,7 +3560,7 @@ inline int enet_protocol_send_outgoing_commands(ENetHost* host, ENetEvent* event
 
 			if(checkForTimeouts != 0 && !enet_list_empty(&currentPeer->sentReliableCommands) && ENET_TIME_GREATER_EQUAL(host->serviceTime, currentPeer->nextTimeout) && enet_protocol_check_timeouts(host, currentPeer, event) == 1) {
 				if(event != NULL && event->type != ENET_EVENT_TYPE_NONE)
-					return 1;
+					return enet_protocol_flush_datagrams(host) < 0 ? -1 : 1;
 				else
 					continue;
 			}
@@ -2886,14 +3588,16 @@ inline int enet_protocol_send_outgoing_commands(ENetHost* host, ENetEvent* event
 			header->peerID = ENET_HOST_TO_NET_16(currentPeer->outgoingPeerID | host->headerFlags);
 
 			if(host->checksumCallback != NULL) {
-				enet_checksum* checksum = (enet_checksum*)&headerData[host->buffers->dataLength];
-				*checksum = currentPeer->outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID ? currentPeer->connectID : 0;
+				uint8_t* checksum = &headerData[host->buffers->dataLength];
+				enet_checksum value = currentPeer->outgoingPeerID < ENET_PROTOCOL_MAXIMUM_PEER_ID ? currentPeer->connectID : 0;
+				memcpy(checksum, &value, sizeof(enet_checksum));
 				host->buffers->dataLength += sizeof(enet_checksum);
-				*checksum = host->checksumCallback(host->buffers, host->bufferCount);
+				value = host->checksumCallback(host->buffers, host->bufferCount);
+				memcpy(checksum, &value, sizeof(enet_checksum));
 			}
 
 			currentPeer->lastSendTime = host->serviceTime;
-			sentLength = enet_socket_send(host->socket, &currentPeer->address, host->buffers, host->bufferCount);
+			sentLength = enet_protocol_send_datagram(host, currentPeer);
 
 			enet_protocol_remove_sent_unreliable_commands(currentPeer);
 
@@ -2906,28 +3610,268 @@ inline int enet_protocol_send_outgoing_commands(ENetHost* host, ENetEvent* event
 		}
 	}
 
-	return 0;
+	enet_protocol_update_service_deadline(host);
+
+	return enet_protocol_flush_datagrams(host);
 }
 
-inline void enet_host_flush(ENetHost* host) {
-	host->serviceTime = enet_time_get();
+inline void enet_protocol_update_service_deadline(ENetHost* host) {
+	ENetPeer* currentPeer;
+	uint32_t peerDeadline;
+	size_t activeIndex;
+	uint32_t deadline = host->serviceTime + ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL;
 
-	enet_protocol_send_outgoing_commands(host, NULL, 0);
-}
+	for(activeIndex = 0; activeIndex < host->activePeerCount; ++activeIndex) {
+		currentPeer = host->activePeers[activeIndex];
 
-inline int enet_host_check_events(ENetHost* host, ENetEvent* event) {
-	if(event == NULL)
-		return -1;
+		if(currentPeer->state == ENET_PEER_STATE_ZOMBIE)
+			continue;
 
-	event->type = ENET_EVENT_TYPE_NONE;
-	event->peer = NULL;
-	event->packet = NULL;
+		if(currentPeer->cookiePending)
+			peerDeadline = currentPeer->cookieTime + ENET_HOST_COOKIE_RETRY;
+		else if(!enet_list_empty(&currentPeer->sentReliableCommands))
+			peerDeadline = currentPeer->nextTimeout;
+		else
+			peerDeadline = currentPeer->lastReceiveTime + currentPeer->pingInterval;
 
-	return enet_protocol_dispatch_incoming_commands(host, event);
-}
+		/* Paced data is sent again at its departure time, or once held data reaches the burst limit */
+		if(currentPeer->pacingLimited && currentPeer->pacingRate != 0 && !enet_list_empty(&currentPeer->outgoingCommands)) {
+			uint64_t wait = currentPeer->pacingTime - host->pacingTime - (host->pacing == ENET_PACING_TXTIME ? ENET_PEER_PACING_BURST * UINT64_C(1000000) : 0);
+			uint32_t pacingDeadline = host->serviceTime + 1 + (uint32_t)ENET_MIN(wait / 1000000, (uint64_t)ENET_PEER_PACING_BURST);
 
-inline int enet_host_service(ENetHost* host, ENetEvent* event, uint32_t timeout) {
-	uint32_t waitCondition;
+			if(ENET_TIME_LESS(pacingDeadline, peerDeadline))
+				peerDeadline = pacingDeadline;
+		}
+
+		/* Timer already passed but nothing could be sent, retry on next millisecond instead of spinning */
+		if(ENET_TIME_LESS_EQUAL(peerDeadline, host->serviceTime))
+			peerDeadline = host->serviceTime + 1;
+
+		if(ENET_TIME_LESS(peerDeadline, deadline))
+			deadline = peerDeadline;
+	}
+
+	host->serviceDeadline = deadline;
+}
+
+/* Departure time of the next paced data in nanoseconds, advanced at the rate of congestion control or, when the host paces on its own,
+   at window over round trip time with a quarter of headroom. It is pulled up to the credit of this pass so idle time is not saved up.
+   Returns 1 when the rate is the own estimate of the host, then data is not held longer than a burst */
+inline int enet_protocol_pace_outgoing_commands(ENetHost* host, ENetPeer* peer) {
+	uint32_t rate = host->congestionControl->rate != NULL ? host->congestionControl->rate(peer) : 0;
+	int estimated = 0;
+
+	if(rate == 0 && host->pacing != ENET_PACING_NONE) {
+		rate = (uint32_t)ENET_MIN((uint64_t)ENET_MAX(host->congestionControl->window(peer), peer->mtu) * 1250 / ENET_MAX(peer->roundTripTime, 1), UINT32_MAX);
+		estimated = 1;
+	}
+
+	if(rate == 0) {
+		peer->pacingRate = 0;
+
+		return 0;
+	}
+
+	if(peer->pacingRate == 0 || peer->pacingTime + host->pacingCredit < host->pacingTime)
+		peer->pacingTime = host->pacingTime - host->pacingCredit;
+
+	peer->pacingRate = rate;
+
+	return estimated;
+}
+
+/* Connect id of a cookie: keyed hash of address, time period and the attempt, outgoing peer id and session ids as the connect carries them */
+inline uint32_t enet_protocol_cookie(const ENetHost* host, const ENetAddress* address, uint32_t period, const uint8_t* attempt) {
+	uint8_t data[sizeof(address->ipv6) + sizeof(address->port) + sizeof(period) + ENET_HOST_COOKIE_ATTEMPT_SIZE];
+	memcpy(data, &address->ipv6, sizeof(address->ipv6));
+	memcpy(data + sizeof(address->ipv6), &address->port, sizeof(address->port));
+	memcpy(data + sizeof(address->ipv6) + sizeof(address->port), &period, sizeof(period));
+	memcpy(data + sizeof(address->ipv6) + sizeof(address->port) + sizeof(period), attempt, ENET_HOST_COOKIE_ATTEMPT_SIZE);
+
+	return (uint32_t)enet_siphash(host->cookieKey, data, sizeof(data));
+}
+
+/* Attempt of a pending peer in the layout of ENetProtocolConnect, outgoingPeerID followed by both session ids */
+inline void enet_protocol_cookie_attempt(const ENetPeer* peer, uint8_t* attempt) {
+	const uint16_t outgoingPeerID = ENET_HOST_TO_NET_16(peer->incomingPeerID);
+	memcpy(attempt, &outgoingPeerID, sizeof(outgoingPeerID));
+	attempt[2] = peer->incomingSessionID;
+	attempt[3] = peer->outgoingSessionID;
+}
+
+inline int enet_protocol_send_cookie_request(ENetHost* host, ENetPeer* peer) {
+	uint8_t request[ENET_HOST_COOKIE_REQUEST_SIZE] = { 0xFF, 0xFF, 'C', 'Q' };
+	ENetBuffer buffer;
+	enet_protocol_cookie_attempt(peer, request + 4);
+	buffer.data = request;
+	buffer.dataLength = sizeof(request);
+	peer->cookieTime = host->serviceTime;
+
+	return enet_socket_send(host->socket, &peer->address, &buffer, 1);
+}
+
+/* Stateless pre-handshake: request is answered with a keyed hash of address, connect attempt and time period,
+   the reply is never larger than the request, connect without a cookie of current or previous period is dropped before a peer is taken */
+inline int enet_protocol_handle_cookie(ENetHost* host) {
+	const uint8_t* data = host->receivedData;
+	const size_t dataLength = host->receivedDataLength;
+	const ENetProtocol* command;
+	uint64_t startTime;
+	uint32_t period, cookie, connectID;
+	uint16_t peerID;
+	size_t headerSize, activeIndex;
+
+	if(dataLength == ENET_HOST_COOKIE_REQUEST_SIZE && data[0] == 0xFF && data[1] == 0xFF && data[2] == 'C' && data[3] == 'Q') {
+		uint8_t reply[ENET_HOST_COOKIE_REPLY_SIZE] = { 0xFF, 0xFF, 'C', 'R' };
+		ENetBuffer buffer;
+		startTime = enet_time_get_ns();
+		cookie = enet_protocol_cookie(host, &host->receivedAddress, host->serviceTime / ENET_HOST_COOKIE_PERIOD, data + 4);
+		memcpy(reply + 4, data + 4, ENET_HOST_COOKIE_ATTEMPT_SIZE);
+		memcpy(reply + 4 + ENET_HOST_COOKIE_ATTEMPT_SIZE, &cookie, sizeof(cookie));
+		buffer.data = reply;
+		buffer.dataLength = sizeof(reply);
+		enet_socket_send(host->socket, &host->receivedAddress, &buffer, 1);
+		host->totalCookieReplies++;
+		host->totalCookieTime += enet_time_get_ns() - startTime;
+
+		return 1;
+	}
+
+	if(dataLength == ENET_HOST_COOKIE_REPLY_SIZE && data[0] == 0xFF && data[1] == 0xFF && data[2] == 'C' && data[3] == 'R') {
+		for(activeIndex = 0; activeIndex < host->activePeerCount; ++activeIndex) {
+			ENetPeer* currentPeer = host->activePeers[activeIndex];
+			uint8_t attempt[ENET_HOST_COOKIE_ATTEMPT_SIZE];
+
+			if(!currentPeer->cookiePending || !enet_in6_equal(currentPeer->address.ipv6, host->receivedAddress.ipv6) || currentPeer->address.port != host->receivedAddress.port)
+				continue;
+
+			/* Reply to an earlier attempt carries another attempt and is ignored */
+			enet_protocol_cookie_attempt(currentPeer, attempt);
+
+			if(!memcmp(attempt, data + 4, sizeof(attempt))) {
+				memcpy(&currentPeer->connectID, data + 4 + ENET_HOST_COOKIE_ATTEMPT_SIZE, sizeof(currentPeer->connectID));
+				currentPeer->cookiePending = 0;
+				enet_peer_queue_connect(currentPeer, currentPeer->cookieData);
+
+				break;
+			}
+		}
+
+		return 1;
+	}
+
+	/* Only a datagram holding exactly one connect command may take a peer, anything else is left to the protocol */
+	if(dataLength < (size_t) & ((ENetProtocolHeader*)0)->sentTime)
+		return 0;
+
+	peerID = ENET_NET_TO_HOST_16(((const ENetProtocolHeader*)data)->peerID);
+	headerSize = (peerID & ENET_PROTOCOL_HEADER_FLAG_SENT_TIME ? sizeof(ENetProtocolHeader) : (size_t) & ((ENetProtocolHeader*)0)->sentTime);
+
+	if(host->checksumCallback != NULL)
+		headerSize += sizeof(enet_checksum);
+
+	if((peerID & ~(ENET_PROTOCOL_HEADER_FLAG_MASK | ENET_PROTOCOL_HEADER_SESSION_MASK)) != ENET_PROTOCOL_MAXIMUM_PEER_ID || dataLength != headerSize + sizeof(ENetProtocolConnect))
+		return 0;
+
+	command = (const ENetProtocol*)&data[headerSize];
+
+	if((command->header.command & ENET_PROTOCOL_COMMAND_MASK) != ENET_PROTOCOL_COMMAND_CONNECT)
+		return 0;
+
+	startTime = enet_time_get_ns();
+	period = host->serviceTime / ENET_HOST_COOKIE_PERIOD;
+	memcpy(&connectID, &command->connect.connectID, sizeof(connectID));
+
+	/* Outgoing peer id and both session ids lie together in the connect, the full 32 bits of the connect id are keyed */
+	if(connectID != enet_protocol_cookie(host, &host->receivedAddress, period, (const uint8_t*)&command->connect.outgoingPeerID) && connectID != enet_protocol_cookie(host, &host->receivedAddress, period - 1, (const uint8_t*)&command->connect.outgoingPeerID)) {
+		host->totalCookieRejects++;
+		host->totalCookieTime += enet_time_get_ns() - startTime;
+
+		return 1;
+	}
+
+	host->totalCookieTime += enet_time_get_ns() - startTime;
+
+	return 0;
+}
+
+/* Token bucket per source address in an open addressing table, an idle bucket refilled to capacity counts as free,
+   a full probe window evicts its least recently used bucket. Port is not part of the key, one host rotating source ports
+   shares its bucket, IPv6 sources share the bucket of their /64 prefix */
+inline int enet_protocol_rate_limit(ENetHost* host) {
+	const ENetAddress* address = &host->receivedAddress;
+	ENetRateBucket* bucket = NULL;
+	ENetRateBucket* freeBucket = NULL;
+	ENetRateBucket* oldestBucket = NULL;
+	uint64_t hash, tokens;
+	uint32_t tag, elapsed;
+	size_t probe;
+
+	if(address->ipv4.ffff == 0xFFFF && !memcmp(address->ipv4.zeros, "\0\0\0\0\0\0\0\0\0\0", sizeof(address->ipv4.zeros)))
+		hash = enet_siphash(host->rateKey, (const uint8_t*)&address->ipv6, sizeof(address->ipv6));
+	else
+		hash = enet_siphash(host->rateKey, (const uint8_t*)&address->ipv6, sizeof(address->ipv6) / 2);
+	tag = (uint32_t)(hash >> 32) | 1;
+
+	for(probe = 0; probe < ENET_HOST_RATE_LIMIT_PROBES; ++probe) {
+		ENetRateBucket* currentBucket = &host->rateTable[(hash + probe) & host->rateTableMask];
+
+		if(currentBucket->tag == tag) {
+			bucket = currentBucket;
+
+			break;
+		}
+
+		if(freeBucket == NULL && (currentBucket->tag == 0 || ENET_TIME_DIFFERENCE(host->serviceTime, currentBucket->time) >= host->rateRefillTime))
+			freeBucket = currentBucket;
+
+		if(oldestBucket == NULL || ENET_TIME_LESS(currentBucket->time, oldestBucket->time))
+			oldestBucket = currentBucket;
+	}
+
+	if(bucket == NULL) {
+		bucket = freeBucket != NULL ? freeBucket : oldestBucket;
+		bucket->tag = tag;
+		bucket->tokens = host->rateCapacity;
+	} else {
+		elapsed = ENET_TIME_DIFFERENCE(host->serviceTime, bucket->time);
+		tokens = elapsed >= host->rateRefillTime ? host->rateCapacity : bucket->tokens + (uint64_t)elapsed * host->rateLimit;
+		bucket->tokens = tokens > host->rateCapacity ? host->rateCapacity : (uint32_t)tokens;
+	}
+
+	bucket->time = host->serviceTime;
+
+	if(bucket->tokens < ENET_HOST_RATE_LIMIT_TOKEN) {
+		host->totalLimitedPackets++;
+		host->totalLimitedData += host->receivedDataLength;
+
+		return 1;
+	}
+
+	bucket->tokens -= ENET_HOST_RATE_LIMIT_TOKEN;
+
+	return 0;
+}
+
+inline void enet_host_flush(ENetHost* host) {
+	host->serviceTime = enet_time_get();
+
+	enet_protocol_send_outgoing_commands(host, NULL, 0);
+}
+
+inline int enet_host_check_events(ENetHost* host, ENetEvent* event) {
+	if(event == NULL)
+		return -1;
+
+	event->type = ENET_EVENT_TYPE_NONE;
+	event->peer = NULL;
+	event->packet = NULL;
+
+	return enet_protocol_dispatch_incoming_commands(host, event);
+}
+
+inline int enet_host_service(ENetHost* host, ENetEvent* event, uint32_t timeout) {
+	uint32_t waitCondition;
 
 	if(event != NULL) {
 		event->type = ENET_EVENT_TYPE_NONE;
@@ -3022,6 +3966,13 @@ inline int enet_host_service(ENetHost* host, ENetEvent* event, uint32_t timeout)
 		if(ENET_TIME_GREATER_EQUAL(host->serviceTime, timeout))
 			return 0;
 
+		if(host->receiveBatchIndex < host->receiveBatchCount) {
+			host->serviceTime = enet_time_get();
+			waitCondition = ENET_SOCKET_WAIT_RECEIVE;
+
+			continue;
+		}
+
 		do {
 			host->serviceTime = enet_time_get();
 
@@ -3044,6 +3995,83 @@ inline int enet_host_service(ENetHost* host, ENetEvent* event, uint32_t timeout)
 	return 0;
 }
 
+inline int enet_host_service_batch(ENetHost* host, ENetEvent* events, size_t eventCount) {
+	ENetEvent* event;
+	size_t count = 0;
+
+	host->serviceTime = enet_time_get();
+
+	if(ENET_TIME_DIFFERENCE(host->serviceTime, host->bandwidthThrottleEpoch) >= ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL)
+		enet_host_bandwidth_throttle(host);
+
+	/* One sweep over peers, restarted only when a peer timed out and took an event slot */
+	for(;;) {
+		event = count < eventCount ? &events[count] : NULL;
+
+		if(event != NULL) {
+			event->type = ENET_EVENT_TYPE_NONE;
+			event->peer = NULL;
+			event->packet = NULL;
+		}
+
+		switch(enet_protocol_send_outgoing_commands(host, event, 1)) {
+			case 1:
+				++count;
+
+				continue;
+
+			case -1:
+			#ifdef ENET_DEBUG
+				perror("Error sending outgoing packets");
+			#endif
+
+				return -1;
+
+			default:
+				break;
+		}
+
+		break;
+	}
+
+	/* Without event every connect, disconnect and message goes through dispatch queue */
+	if(enet_protocol_receive_incoming_commands(host, NULL) < 0) {
+	#ifdef ENET_DEBUG
+		perror("Error receiving incoming packets");
+	#endif
+
+		return -1;
+	}
+
+	while(count < eventCount) {
+		event = &events[count];
+		event->type = ENET_EVENT_TYPE_NONE;
+		event->peer = NULL;
+		event->packet = NULL;
+
+		switch(enet_protocol_dispatch_incoming_commands(host, event)) {
+			case 1:
+				++count;
+
+				continue;
+
+			case -1:
+			#ifdef ENET_DEBUG
+				perror("Error dispatching incoming packets");
+			#endif
+
+				return -1;
+
+			default:
+				break;
+		}
+
+		break;
+	}
+
+	return (int)count;
+}
+
 /*
 =======================================================================
 
@@ -3089,6 +4117,152 @@ inline int enet_peer_throttle(ENetPeer* peer, uint32_t rtt) {
 	return 0;
 }
 
+/* Default congestion control: packet throttle driven by round trip time variance, unreliable packets dropped by throttle, no pacing */
+inline void enet_peer_throttle_acknowledge(ENetPeer* peer, uint32_t roundTripTime) {
+	enet_peer_throttle(peer, roundTripTime);
+}
+
+inline uint32_t enet_peer_throttle_window(ENetPeer* peer) {
+	return (peer->packetThrottle * peer->windowSize) / ENET_PEER_PACKET_THROTTLE_SCALE;
+}
+
+inline int enet_peer_throttle_admit(ENetPeer* peer) {
+	peer->packetThrottleCounter += ENET_PEER_PACKET_THROTTLE_COUNTER;
+	peer->packetThrottleCounter %= ENET_PEER_PACKET_THROTTLE_SCALE;
+
+	return peer->packetThrottleCounter <= peer->packetThrottle;
+}
+
+/* Delay based congestion control after BBR: bottleneck bandwidth is the max delivery rate of recent rounds, propagation delay is the
+   min round trip time of the last 10 seconds. Data is paced at gain * bandwidth and reliable data in transit is bounded to a multiple
+   of their product, loss does not shrink the window */
+inline void enet_peer_delay_acknowledge(ENetPeer* peer, uint32_t roundTripTime) {
+	ENetDelayControl* control = &peer->delayControl;
+	uint32_t serviceTime = peer->host->serviceTime, roundLength, elapsed, index;
+	uint64_t sample;
+
+	if(control->minimumRoundTripTime == 0 || roundTripTime <= control->minimumRoundTripTime) {
+		control->minimumRoundTripTime = roundTripTime;
+		control->minimumRoundTripStamp = serviceTime;
+	} else if(ENET_TIME_DIFFERENCE(serviceTime, control->minimumRoundTripStamp) > ENET_PEER_DELAY_ROUND_TRIP_WINDOW) {
+		/* Expired min is measured again with almost empty queue */
+		control->minimumRoundTripTime = roundTripTime;
+		control->minimumRoundTripStamp = serviceTime;
+
+		if(control->mode != ENET_DELAY_MODE_PROBE_ROUND_TRIP) {
+			control->mode = ENET_DELAY_MODE_PROBE_ROUND_TRIP;
+			control->probeStart = serviceTime;
+		}
+	}
+
+	if(control->roundStart == 0) {
+		control->roundStart = ENET_MAX(serviceTime, 1);
+		control->roundDelivered = peer->deliveredData;
+
+		return;
+	}
+
+	roundLength = control->minimumRoundTripTime;
+	elapsed = ENET_TIME_DIFFERENCE(serviceTime, control->roundStart);
+
+	if(elapsed >= roundLength) {
+		/* Application limited round only raises the estimate, it does not show what the path can take */
+		int limited = enet_list_empty(&peer->outgoingCommands) && peer->reliableDataInTransit < enet_peer_delay_window(peer);
+		sample = ENET_MIN((peer->deliveredData - control->roundDelivered) * 1000 / elapsed, 0xFFFFFFFF);
+
+		if(!limited || sample >= control->maximumBandwidth)
+			control->bandwidth[++control->round % ENET_PEER_DELAY_BANDWIDTH_ROUNDS] = (uint32_t)sample;
+
+		for(control->maximumBandwidth = 0, index = 0; index < ENET_PEER_DELAY_BANDWIDTH_ROUNDS; ++index)
+			control->maximumBandwidth = ENET_MAX(control->maximumBandwidth, control->bandwidth[index]);
+
+		control->roundStart = ENET_MAX(serviceTime, 1);
+		control->roundDelivered = peer->deliveredData;
+
+		/* Pipe is full when bandwidth grows less than 25% for 3 rounds */
+		if(control->mode == ENET_DELAY_MODE_STARTUP && !limited) {
+			if(control->maximumBandwidth >= (uint64_t)control->fullBandwidth * 5 / 4) {
+				control->fullBandwidth = control->maximumBandwidth;
+				control->fullBandwidthRounds = 0;
+			} else if(++control->fullBandwidthRounds >= ENET_PEER_DELAY_FULL_ROUNDS) {
+				control->mode = ENET_DELAY_MODE_DRAIN;
+			}
+		}
+	}
+
+	switch(control->mode) {
+		case ENET_DELAY_MODE_DRAIN:
+			if(peer->reliableDataInTransit <= enet_peer_delay_product(peer, ENET_PEER_DELAY_GAIN_SCALE)) {
+				control->mode = ENET_DELAY_MODE_PROBE_BANDWIDTH;
+				control->cycleIndex = 0;
+				control->cycleStart = serviceTime;
+			}
+
+			break;
+
+		case ENET_DELAY_MODE_PROBE_BANDWIDTH:
+			if(ENET_TIME_DIFFERENCE(serviceTime, control->cycleStart) >= roundLength) {
+				control->cycleIndex = (control->cycleIndex + 1) % ENET_PEER_DELAY_CYCLE_LENGTH;
+				control->cycleStart = serviceTime;
+			}
+
+			break;
+
+		case ENET_DELAY_MODE_PROBE_ROUND_TRIP:
+			if(ENET_TIME_DIFFERENCE(serviceTime, control->probeStart) >= ENET_PEER_DELAY_PROBE_TIME) {
+				control->mode = control->fullBandwidthRounds >= ENET_PEER_DELAY_FULL_ROUNDS ? ENET_DELAY_MODE_PROBE_BANDWIDTH : ENET_DELAY_MODE_STARTUP;
+				control->cycleStart = serviceTime;
+			}
+
+			break;
+	}
+}
+
+inline uint32_t enet_peer_delay_product(const ENetPeer* peer, uint32_t gain) {
+	uint64_t product = (uint64_t)peer->delayControl.maximumBandwidth * peer->delayControl.minimumRoundTripTime / 1000 * gain / ENET_PEER_DELAY_GAIN_SCALE;
+
+	return (uint32_t)ENET_MIN(ENET_MAX(product, (uint64_t)ENET_PEER_DELAY_MINIMUM_WINDOW * peer->mtu), 0xFFFFFFFF);
+}
+
+inline uint32_t enet_peer_delay_window(ENetPeer* peer) {
+	if(peer->delayControl.mode == ENET_DELAY_MODE_PROBE_ROUND_TRIP)
+		return ENET_PEER_DELAY_MINIMUM_WINDOW * peer->mtu;
+
+	if(peer->delayControl.maximumBandwidth == 0)
+		return ENET_PEER_DELAY_INITIAL_WINDOW * peer->mtu;
+
+	return enet_peer_delay_product(peer, peer->delayControl.mode == ENET_DELAY_MODE_PROBE_BANDWIDTH ? ENET_PEER_DELAY_WINDOW_GAIN : ENET_PEER_DELAY_HIGH_GAIN);
+}
+
+inline int enet_peer_delay_admit(ENetPeer* peer) {
+	(void)peer;
+
+	return 1;
+}
+
+/* Probe cycle sends faster for one round, drains the queue it made for one round and cruises for six */
+inline uint32_t enet_peer_delay_rate(ENetPeer* peer) {
+	static const uint16_t cycleGains[ENET_PEER_DELAY_CYCLE_LENGTH] = {320, 192, 256, 256, 256, 256, 256, 256};
+	uint32_t gain = ENET_PEER_DELAY_GAIN_SCALE;
+
+	switch(peer->delayControl.mode) {
+		case ENET_DELAY_MODE_STARTUP:
+			gain = ENET_PEER_DELAY_HIGH_GAIN;
+			break;
+
+		case ENET_DELAY_MODE_DRAIN:
+			gain = ENET_PEER_DELAY_DRAIN_GAIN;
+			break;
+
+		case ENET_DELAY_MODE_PROBE_BANDWIDTH:
+			gain = cycleGains[peer->delayControl.cycleIndex];
+			break;
+	}
+
+	/* Unpaced until the first round gives a delivery rate, initial window bounds the start */
+	return (uint32_t)ENET_MIN((uint64_t)peer->delayControl.maximumBandwidth * gain / ENET_PEER_DELAY_GAIN_SCALE, 0xFFFFFFFF);
+}
+
 inline int enet_peer_send(ENetPeer* peer, uint8_t channelID, ENetPacket* packet) {
 	ENetChannel* channel;
 	ENetProtocol command;
@@ -3187,6 +4361,149 @@ inline int enet_peer_send(ENetPeer* peer, uint8_t channelID, ENetPacket* packet)
 	return 0;
 }
 
+/* Unreliable send where a queued, not yet sent command with the same key gets the new packet instead of a new command */
+/* Pending Latest commands by channel and key: open addressing with linear probing over a power of two table, kept at most half full,
+   an entry lives from the first send of the key until its command leaves the outgoing queue */
+inline size_t enet_peer_latest_slot(const ENetPeer* peer, uint8_t channelID, uint32_t key) {
+	return (size_t)((((uint64_t)channelID << 32 | key) * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (peer->latestCapacity - 1);
+}
+
+inline ENetOutgoingCommand** enet_peer_find_latest(ENetPeer* peer, uint8_t channelID, uint32_t key) {
+	size_t slot;
+
+	if(peer->latestCount == 0)
+		return NULL;
+
+	for(slot = enet_peer_latest_slot(peer, channelID, key); peer->latestCommands[slot] != NULL; slot = (slot + 1) & (peer->latestCapacity - 1)) {
+		if(peer->latestCommands[slot]->replaceKey == key && peer->latestCommands[slot]->command.header.channelID == channelID)
+			return &peer->latestCommands[slot];
+	}
+
+	return NULL;
+}
+
+inline int enet_peer_index_latest(ENetPeer* peer, ENetOutgoingCommand* outgoingCommand) {
+	ENetOutgoingCommand** commands = peer->latestCommands;
+	size_t capacity = peer->latestCapacity, index, slot;
+
+	if((peer->latestCount + 1) * 2 > peer->latestCapacity) {
+		size_t newCapacity = ENET_MAX(capacity * 2, (size_t)ENET_PEER_LATEST_MINIMUM);
+
+		peer->latestCommands = (ENetOutgoingCommand**)enet_malloc(newCapacity * sizeof(ENetOutgoingCommand*));
+
+		if(peer->latestCommands == NULL) {
+			peer->latestCommands = commands;
+
+			return -1;
+		}
+
+		memset(peer->latestCommands, 0, newCapacity * sizeof(ENetOutgoingCommand*));
+		peer->latestCapacity = newCapacity;
+
+		for(index = 0; index < capacity; ++index) {
+			if(commands[index] == NULL)
+				continue;
+
+			slot = enet_peer_latest_slot(peer, commands[index]->command.header.channelID, commands[index]->replaceKey);
+
+			while(peer->latestCommands[slot] != NULL)
+				slot = (slot + 1) & (newCapacity - 1);
+
+			peer->latestCommands[slot] = commands[index];
+		}
+
+		if(commands != NULL)
+			enet_free(commands);
+	}
+
+	slot = enet_peer_latest_slot(peer, outgoingCommand->command.header.channelID, outgoingCommand->replaceKey);
+
+	while(peer->latestCommands[slot] != NULL)
+		slot = (slot + 1) & (peer->latestCapacity - 1);
+
+	peer->latestCommands[slot] = outgoingCommand;
+	++peer->latestCount;
+
+	return 0;
+}
+
+/* Backward shift deletion, entries behind the hole move into it unless their home slot lies between the hole and them */
+inline void enet_peer_remove_latest(ENetPeer* peer, const ENetOutgoingCommand* outgoingCommand) {
+	ENetOutgoingCommand** latestCommand = enet_peer_find_latest(peer, outgoingCommand->command.header.channelID, outgoingCommand->replaceKey);
+	size_t mask = peer->latestCapacity - 1, slot, next, home;
+
+	if(latestCommand == NULL || *latestCommand != outgoingCommand)
+		return;
+
+	slot = (size_t)(latestCommand - peer->latestCommands);
+
+	for(next = (slot + 1) & mask; peer->latestCommands[next] != NULL; next = (next + 1) & mask) {
+		home = enet_peer_latest_slot(peer, peer->latestCommands[next]->command.header.channelID, peer->latestCommands[next]->replaceKey);
+
+		if(((next - home) & mask) >= ((next - slot) & mask)) {
+			peer->latestCommands[slot] = peer->latestCommands[next];
+			slot = next;
+		}
+	}
+
+	peer->latestCommands[slot] = NULL;
+	--peer->latestCount;
+}
+
+inline int enet_peer_send_latest(ENetPeer* peer, uint8_t channelID, ENetPacket* packet, uint32_t key) {
+	ENetOutgoingCommand** latestCommand;
+	ENetOutgoingCommand* outgoingCommand;
+	size_t fragmentLength;
+
+	if(key == 0 || packet->flags & (ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_UNSEQUENCED | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENTED))
+		return enet_peer_send(peer, channelID, packet);
+
+	if(peer->state != ENET_PEER_STATE_CONNECTED || channelID >= peer->channelCount)
+		return -1;
+
+	fragmentLength = peer->mtu - sizeof(ENetProtocolHeader) - sizeof(ENetProtocolSendFragment) - sizeof(ENetProtocolAcknowledge);
+
+	if(peer->host->checksumCallback != NULL)
+		fragmentLength -= sizeof(enet_checksum);
+
+	if(packet->dataLength <= fragmentLength) {
+		latestCommand = enet_peer_find_latest(peer, channelID, key);
+
+		if(latestCommand != NULL) {
+			outgoingCommand = *latestCommand;
+			peer->outgoingDataTotal -= outgoingCommand->fragmentLength;
+			peer->outgoingDataTotal += (uint32_t)packet->dataLength;
+
+			if(--outgoingCommand->packet->referenceCount == 0)
+				enet_packet_destroy(outgoingCommand->packet);
+
+			++packet->referenceCount;
+			outgoingCommand->packet = packet;
+			outgoingCommand->fragmentLength = (uint16_t)packet->dataLength;
+			outgoingCommand->command.sendUnreliable.dataLength = ENET_HOST_TO_NET_16(packet->dataLength);
+			++peer->host->totalReplacedCommands;
+
+			return 0;
+		}
+	}
+
+	if(enet_peer_send(peer, channelID, packet) < 0)
+		return -1;
+
+	/* Only a single unreliable command can be replaced, fragments and reliable fallback keep no key */
+	outgoingCommand = (ENetOutgoingCommand*)enet_list_previous(enet_list_end(&peer->outgoingCommands));
+
+	if(outgoingCommand->packet == packet && outgoingCommand->fragmentLength == packet->dataLength && (outgoingCommand->command.header.command & ENET_PROTOCOL_COMMAND_MASK) == ENET_PROTOCOL_COMMAND_SEND_UNRELIABLE) {
+		outgoingCommand->replaceKey = key;
+
+		/* Without room in the index the command is sent as a plain one */
+		if(enet_peer_index_latest(peer, outgoingCommand) < 0)
+			outgoingCommand->replaceKey = 0;
+	}
+
+	return 0;
+}
+
 inline ENetPacket* enet_peer_receive(ENetPeer* peer, uint8_t* channelID) {
 	ENetIncomingCommand* incomingCommand;
 	ENetPacket* packet;
@@ -3277,6 +4594,13 @@ inline void enet_peer_reset_queues(ENetPeer* peer) {
 	enet_peer_reset_outgoing_commands(&peer->outgoingCommands);
 	enet_peer_reset_incoming_commands(&peer->dispatchedCommands);
 
+	if(peer->latestCommands != NULL)
+		enet_free(peer->latestCommands);
+
+	peer->latestCommands = NULL;
+	peer->latestCapacity = 0;
+	peer->latestCount = 0;
+
 	if(peer->channels != NULL && peer->channelCount > 0) {
 		for(channel = peer->channels; channel < &peer->channels[peer->channelCount]; ++channel) {
 			enet_peer_reset_incoming_commands(&channel->incomingReliableCommands);
@@ -3311,6 +4635,9 @@ inline void enet_peer_on_disconnect(ENetPeer* peer) {
 inline void enet_peer_reset(ENetPeer* peer) {
 	enet_peer_on_disconnect(peer);
 
+	if(peer->state != ENET_PEER_STATE_DISCONNECTED)
+		enet_host_deactivate_peer(peer->host, peer);
+
 	peer->outgoingPeerID = ENET_PROTOCOL_MAXIMUM_PEER_ID;
 	peer->state = ENET_PEER_STATE_DISCONNECTED;
 	peer->incomingBandwidth = 0;
@@ -3353,8 +4680,18 @@ inline void enet_peer_reset(ENetPeer* peer) {
 	peer->outgoingUnsequencedGroup = 0;
 	peer->eventData = 0;
 	peer->totalWaitingData = 0;
+	peer->cookiePending = 0;
+	peer->scheduleTime = 0;
+	peer->scheduleDirty = 0;
+	peer->deliveredData = 0;
+	peer->unreliableDataSent = 0;
+	peer->unreliableDataDelivered = 0;
+	peer->pacingRate = 0;
+	peer->pacingTime = 0;
+	peer->pacingLimited = 0;
 
 	memset(peer->unsequencedWindow, 0, sizeof(peer->unsequencedWindow));
+	memset(&peer->delayControl, 0, sizeof(peer->delayControl));
 
 	enet_peer_reset_queues(peer);
 }
@@ -3459,6 +4796,7 @@ inline ENetAcknowledgement* enet_peer_queue_acknowledgement(ENetPeer* peer, cons
 	if(acknowledgement == NULL)
 		return NULL;
 
+	peer->host->serviceDeadline = peer->host->serviceTime;
 	peer->outgoingDataTotal += sizeof(ENetProtocolAcknowledge);
 	acknowledgement->sentTime = sentTime;
 	acknowledgement->command = *command;
@@ -3493,8 +4831,12 @@ inline void enet_peer_setup_outgoing_command(ENetPeer* peer, ENetOutgoingCommand
 		outgoingCommand->unreliableSequenceNumber = channel->outgoingUnreliableSequenceNumber;
 	}
 
+	peer->scheduleDirty = 1;
 	outgoingCommand->sendAttempts = 0;
+	outgoingCommand->replaceKey = 0;
+	outgoingCommand->queueTime = peer->host->queueDelay != NULL || peer->host->pacing != ENET_PACING_NONE ? enet_time_get_ns() : 0;
 	outgoingCommand->sentTime = 0;
+	outgoingCommand->sentData = 0;
 	outgoingCommand->roundTripTimeout = 0;
 	outgoingCommand->roundTripTimeoutLimit = 0;
 	outgoingCommand->command.header.reliableSequenceNumber = ENET_HOST_TO_NET_16(outgoingCommand->reliableSequenceNumber);
@@ -3523,6 +4865,7 @@ inline ENetOutgoingCommand* enet_peer_queue_outgoing_command(ENetPeer* peer, con
 	if(outgoingCommand == NULL)
 		return NULL;
 
+	peer->host->serviceDeadline = peer->host->serviceTime;
 	outgoingCommand->command = *command;
 	outgoingCommand->fragmentOffset = offset;
 	outgoingCommand->fragmentLength = length;
@@ -3817,7 +5160,7 @@ notifyError:
 */
 
 inline ENetHost* enet_host_create(const ENetAddress* address, size_t peerCount, size_t channelLimit,
-	uint32_t incomingBandwidth, uint32_t outgoingBandwidth, uint32_t bufferSize = ENET_HOST_BUFFER_SIZE_MAX) 
+	uint32_t incomingBandwidth, uint32_t outgoingBandwidth, uint32_t bufferSize = ENET_HOST_BUFFER_SIZE_MAX, int reusePort = 0) 
 {
 	ENetHost* host;
 	ENetPeer* currentPeer;
@@ -3842,15 +5185,31 @@ inline ENetHost* enet_host_create(const ENetAddress* address, size_t peerCount,
 
 	memset(host->peers, 0, peerCount * sizeof(ENetPeer));
 
+	host->activePeers = (ENetPeer**)enet_malloc(peerCount * sizeof(ENetPeer*));
+
+	if(host->activePeers == NULL) {
+		enet_free(host->peers);
+		enet_free(host);
+
+		return NULL;
+	}
+
 	host->socket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
 
 	if(host->socket != ENET_SOCKET_NULL)
 		enet_socket_set_option(host->socket, ENET_SOCKOPT_IPV6_V6ONLY, 0);
 
+	/* Hosts bound to the same port with SO_REUSEPORT share incoming flows by the kernel hash */
+	if(host->socket != ENET_SOCKET_NULL && reusePort && enet_socket_set_option(host->socket, ENET_SOCKOPT_REUSEPORT, 1) < 0) {
+		enet_socket_destroy(host->socket);
+		host->socket = ENET_SOCKET_NULL;
+	}
+
 	if(host->socket == ENET_SOCKET_NULL || (address != NULL && enet_socket_bind(host->socket, address) < 0)) {
 		if(host->socket != ENET_SOCKET_NULL)
 			enet_socket_destroy(host->socket);
 
+		enet_free(host->activePeers);
 		enet_free(host->peers);
 		enet_free(host);
 
@@ -3893,10 +5252,43 @@ inline ENetHost* enet_host_create(const ENetAddress* address, size_t peerCount,
 	host->receivedAddress.port = 0;
 	host->receivedData = NULL;
 	host->receivedDataLength = 0;
+	host->receiveBatch = NULL;
+	host->receiveBatchSize = 0;
+	host->receiveBatchCount = 0;
+	host->receiveBatchIndex = 0;
+	host->sendBatch = NULL;
+	host->sendBatchSize = 0;
+	host->sendBatchCount = 0;
 	host->totalSentData = 0;
 	host->totalSentPackets = 0;
 	host->totalReceivedData = 0;
 	host->totalReceivedPackets = 0;
+	host->totalReceiveCalls = 0;
+	host->totalSendCalls = 0;
+	host->totalReplacedCommands = 0;
+	host->totalCookieReplies = 0;
+	host->totalCookieRejects = 0;
+	host->totalCookieTime = 0;
+	host->cookies = 0;
+	host->cookieKey[0] = 0;
+	host->cookieKey[1] = 0;
+	host->rateTable = NULL;
+	host->rateTableMask = 0;
+	host->rateLimit = 0;
+	host->rateCapacity = 0;
+	host->rateRefillTime = 0;
+	host->totalLimitedPackets = 0;
+	host->totalLimitedData = 0;
+	host->channelSchedule = NULL;
+	host->scheduleQueues = NULL;
+	host->scheduleChannelCount = 0;
+	host->queueDelay = NULL;
+	host->congestionControl = enet_congestion_throttle();
+	host->pacing = ENET_PACING_NONE;
+	host->pacingTime = 0;
+	host->pacingCredit = 0;
+	host->pacingOffset = 0;
+	host->sendTime = 0;
 	host->connectedPeers = 0;
 	host->bandwidthLimitedPeers = 0;
 	host->duplicatePeers = ENET_PROTOCOL_MAXIMUM_PEER_ID;
@@ -3935,6 +5327,17 @@ inline void enet_host_destroy(ENetHost* host) {
 		enet_peer_reset(currentPeer);
 	}
 
+	if(host->receiveBatch != NULL)
+		enet_free(host->receiveBatch);
+
+	if(host->sendBatch != NULL)
+		enet_free(host->sendBatch);
+
+	if(host->rateTable != NULL)
+		enet_free(host->rateTable);
+
+	enet_host_set_channel_schedule(host, NULL, 0);
+	enet_free(host->activePeers);
 	enet_free(host->peers);
 	enet_free(host);
 }
@@ -3949,7 +5352,6 @@ inline void enet_host_prevent_connections(ENetHost* host, uint8_t state) {
 inline ENetPeer* enet_host_connect(ENetHost* host, const ENetAddress* address, size_t channelCount, uint32_t data) {
 	ENetPeer* currentPeer;
 	ENetChannel* channel;
-	ENetProtocol command;
 
 	if(channelCount < ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT)
 		channelCount = ENET_PROTOCOL_MINIMUM_CHANNEL_COUNT;
@@ -3971,6 +5373,7 @@ inline ENetPeer* enet_host_connect(ENetHost* host, const ENetAddress* address, s
 
 	currentPeer->channelCount = channelCount;
 	currentPeer->state = ENET_PEER_STATE_CONNECTING;
+	enet_host_activate_peer(host, currentPeer);
 	currentPeer->address = *address;
 	currentPeer->connectID = ++host->randomSeed;
 
@@ -3994,38 +5397,62 @@ inline ENetPeer* enet_host_connect(ENetHost* host, const ENetAddress* address, s
 		enet_list_clear(&channel->incomingUnreliableCommands);
 
 		channel->usedReliableWindows = 0;
+		channel->scheduleFinish = 0;
 
 		memset(channel->reliableWindows, 0, sizeof(channel->reliableWindows));
 	}
 
+	if(host->cookies != 0) {
+		/* Session ids move on every attempt, the cookie differs from the one of a connection the server may still hold */
+		currentPeer->incomingSessionID = (uint8_t)((currentPeer->incomingSessionID + 1) & (ENET_PROTOCOL_HEADER_SESSION_MASK >> ENET_PROTOCOL_HEADER_SESSION_SHIFT));
+		currentPeer->outgoingSessionID = (uint8_t)((currentPeer->outgoingSessionID + 1) & (ENET_PROTOCOL_HEADER_SESSION_MASK >> ENET_PROTOCOL_HEADER_SESSION_SHIFT));
+		currentPeer->cookieData = data;
+		currentPeer->cookieStart = enet_time_get();
+		currentPeer->cookieTime = currentPeer->cookieStart - ENET_HOST_COOKIE_RETRY;
+		currentPeer->cookiePending = 1;
+		host->serviceDeadline = host->serviceTime;
+
+		return currentPeer;
+	}
+
+	enet_peer_queue_connect(currentPeer, data);
+
+	return currentPeer;
+}
+
+inline void enet_peer_queue_connect(ENetPeer* peer, uint32_t data) {
+	ENetHost* host = peer->host;
+	ENetProtocol command;
+
 	command.header.command = (uint8_t)ENET_PROTOCOL_COMMAND_CONNECT | (uint8_t)ENET_PROTOCOL_COMMAND_FLAG_ACKNOWLEDGE;
 	command.header.channelID = 0xFF;
-	command.connect.outgoingPeerID = ENET_HOST_TO_NET_16(currentPeer->incomingPeerID);
-	command.connect.incomingSessionID = currentPeer->incomingSessionID;
-	command.connect.outgoingSessionID = currentPeer->outgoingSessionID;
-	command.connect.mtu = ENET_HOST_TO_NET_32(currentPeer->mtu);
-	command.connect.windowSize = ENET_HOST_TO_NET_32(currentPeer->windowSize);
-	command.connect.channelCount = ENET_HOST_TO_NET_32(channelCount);
+	command.connect.outgoingPeerID = ENET_HOST_TO_NET_16(peer->incomingPeerID);
+	command.connect.incomingSessionID = peer->incomingSessionID;
+	command.connect.outgoingSessionID = peer->outgoingSessionID;
+	command.connect.mtu = ENET_HOST_TO_NET_32(peer->mtu);
+	command.connect.windowSize = ENET_HOST_TO_NET_32(peer->windowSize);
+	command.connect.channelCount = ENET_HOST_TO_NET_32(peer->channelCount);
 	command.connect.incomingBandwidth = ENET_HOST_TO_NET_32(host->incomingBandwidth);
 	command.connect.outgoingBandwidth = ENET_HOST_TO_NET_32(host->outgoingBandwidth);
-	command.connect.packetThrottleInterval = ENET_HOST_TO_NET_32(currentPeer->packetThrottleInterval);
-	command.connect.packetThrottleAcceleration = ENET_HOST_TO_NET_32(currentPeer->packetThrottleAcceleration);
-	command.connect.packetThrottleDeceleration = ENET_HOST_TO_NET_32(currentPeer->packetThrottleDeceleration);
-	command.connect.connectID = currentPeer->connectID;
+	command.connect.packetThrottleInterval = ENET_HOST_TO_NET_32(peer->packetThrottleInterval);
+	command.connect.packetThrottleAcceleration = ENET_HOST_TO_NET_32(peer->packetThrottleAcceleration);
+	command.connect.packetThrottleDeceleration = ENET_HOST_TO_NET_32(peer->packetThrottleDeceleration);
+	command.connect.connectID = peer->connectID;
 	command.connect.data = ENET_HOST_TO_NET_32(data);
 
-	enet_peer_queue_outgoing_command(currentPeer, &command, NULL, 0, 0);
-
-	return currentPeer;
+	enet_peer_queue_outgoing_command(peer, &command, NULL, 0, 0);
 }
 
 inline void enet_host_broadcast(ENetHost* host, uint8_t channelID, ENetPacket* packet) {
 	ENetPeer* currentPeer;
+	size_t activeIndex;
 
 	if(packet->flags & ENET_PACKET_FLAG_INSTANT)
 		++packet->referenceCount;
 
-	for(currentPeer = host->peers; currentPeer < &host->peers[host->peerCount]; ++currentPeer) {
+	for(activeIndex = 0; activeIndex < host->activePeerCount; ++activeIndex) {
+		currentPeer = host->activePeers[activeIndex];
+
 		if(currentPeer->state != ENET_PEER_STATE_CONNECTED)
 			continue;
 
@@ -4041,11 +5468,14 @@ inline void enet_host_broadcast(ENetHost* host, uint8_t channelID, ENetPacket* p
 
 inline void enet_host_broadcast_exclude(ENetHost* host, uint8_t channelID, ENetPacket* packet, ENetPeer* excludedPeer) {
 	ENetPeer* currentPeer;
+	size_t activeIndex;
 
 	if(packet->flags & ENET_PACKET_FLAG_INSTANT)
 		++packet->referenceCount;
 
-	for(currentPeer = host->peers; currentPeer < &host->peers[host->peerCount]; ++currentPeer) {
+	for(activeIndex = 0; activeIndex < host->activePeerCount; ++activeIndex) {
+		currentPeer = host->activePeers[activeIndex];
+
 		if(currentPeer->state != ENET_PEER_STATE_CONNECTED || currentPeer == excludedPeer)
 			continue;
 
@@ -4100,6 +5530,18 @@ inline void enet_host_bandwidth_limit(ENetHost* host, uint32_t incomingBandwidth
 	host->recalculateBandwidthLimits = 1;
 }
 
+inline void enet_host_activate_peer(ENetHost* host, ENetPeer* peer) {
+	peer->activeIndex = host->activePeerCount;
+	host->activePeers[host->activePeerCount++] = peer;
+}
+
+inline void enet_host_deactivate_peer(ENetHost* host, ENetPeer* peer) {
+	ENetPeer* lastPeer = host->activePeers[--host->activePeerCount];
+
+	host->activePeers[peer->activeIndex] = lastPeer;
+	lastPeer->activeIndex = peer->activeIndex;
+}
+
 inline void enet_host_bandwidth_throttle(ENetHost* host) {
 	uint32_t timeCurrent = enet_time_get();
 	uint32_t elapsedTime = timeCurrent - host->bandwidthThrottleEpoch;
@@ -4111,6 +5553,7 @@ inline void enet_host_bandwidth_throttle(ENetHost* host) {
 
 	int needsAdjustment = host->bandwidthLimitedPeers > 0 ? 1 : 0;
 	ENetPeer* peer;
+	size_t activeIndex;
 	ENetProtocol command;
 
 	if(elapsedTime < ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL)
@@ -4128,7 +5571,9 @@ inline void enet_host_bandwidth_throttle(ENetHost* host) {
 		dataTotal = 0;
 		bandwidth = (host->outgoingBandwidth * elapsedTime) / 1000;
 
-		for(peer = host->peers; peer < &host->peers[host->peerCount]; ++peer) {
+		for(activeIndex = 0; activeIndex < host->activePeerCount; ++activeIndex) {
+			peer = host->activePeers[activeIndex];
+
 			if(peer->state != ENET_PEER_STATE_CONNECTED && peer->state != ENET_PEER_STATE_DISCONNECT_LATER)
 				continue;
 
@@ -4144,8 +5589,9 @@ inline void enet_host_bandwidth_throttle(ENetHost* host) {
 		else
 			throttle = (bandwidth * ENET_PEER_PACKET_THROTTLE_SCALE) / dataTotal;
 
-		for(peer = host->peers; peer < &host->peers[host->peerCount]; ++peer) {
+		for(activeIndex = 0; activeIndex < host->activePeerCount; ++activeIndex) {
 			uint32_t peerBandwidth;
+			peer = host->activePeers[activeIndex];
 
 			if((peer->state != ENET_PEER_STATE_CONNECTED && peer->state != ENET_PEER_STATE_DISCONNECT_LATER) || peer->incomingBandwidth == 0 || peer->outgoingBandwidthThrottleEpoch == timeCurrent)
 				continue;
@@ -4179,7 +5625,9 @@ inline void enet_host_bandwidth_throttle(ENetHost* host) {
 		else
 			throttle = (bandwidth * ENET_PEER_PACKET_THROTTLE_SCALE) / dataTotal;
 
-		for(peer = host->peers; peer < &host->peers[host->peerCount]; ++peer) {
+		for(activeIndex = 0; activeIndex < host->activePeerCount; ++activeIndex) {
+			peer = host->activePeers[activeIndex];
+
 			if((peer->state != ENET_PEER_STATE_CONNECTED && peer->state != ENET_PEER_STATE_DISCONNECT_LATER) || peer->outgoingBandwidthThrottleEpoch == timeCurrent)
 				continue;
 
@@ -4206,7 +5654,9 @@ inline void enet_host_bandwidth_throttle(ENetHost* host) {
 				needsAdjustment = 0;
 				bandwidthLimit = bandwidth / peersRemaining;
 
-				for(peer = host->peers; peer < &host->peers[host->peerCount]; ++peer) {
+				for(activeIndex = 0; activeIndex < host->activePeerCount; ++activeIndex) {
+					peer = host->activePeers[activeIndex];
+
 					if((peer->state != ENET_PEER_STATE_CONNECTED && peer->state != ENET_PEER_STATE_DISCONNECT_LATER) || peer->incomingBandwidthThrottleEpoch == timeCurrent)
 						continue;
 
@@ -4221,7 +5671,9 @@ inline void enet_host_bandwidth_throttle(ENetHost* host) {
 			}
 		}
 
-		for(peer = host->peers; peer < &host->peers[host->peerCount]; ++peer) {
+		for(activeIndex = 0; activeIndex < host->activePeerCount; ++activeIndex) {
+			peer = host->activePeers[activeIndex];
+
 			if(peer->state != ENET_PEER_STATE_CONNECTED && peer->state != ENET_PEER_STATE_DISCONNECT_LATER)
 				continue;
 
@@ -4482,6 +5934,32 @@ inline int enet_socket_set_option(ENetSocket socket, ENetSocketOption option, in
 
 			break;
 
+	#ifdef SO_REUSEPORT
+		case ENET_SOCKOPT_REUSEPORT:
+			result = setsockopt(socket, SOL_SOCKET, SO_REUSEPORT, (char*)&value, sizeof(int));
+
+			break;
+	#endif
+
+	#ifdef SO_TXTIME
+		/* Departure times are only taken from datagrams that carry one, so the option is never cleared */
+		case ENET_SOCKOPT_TXTIME: {
+			struct sock_txtime txTime;
+
+			if(!value) {
+				result = 0;
+
+				break;
+			}
+
+			txTime.clockid = CLOCK_MONOTONIC;
+			txTime.flags = 0;
+			result = setsockopt(socket, SOL_SOCKET, SO_TXTIME, (char*)&txTime, sizeof(struct sock_txtime));
+
+			break;
+		}
+	#endif
+
 		default:
 			break;
 	}
@@ -4553,9 +6031,20 @@ inline void enet_socket_destroy(ENetSocket socket) {
 }
 
 inline int enet_socket_send(ENetSocket socket, const ENetAddress* address, const ENetBuffer* buffers, size_t bufferCount) {
+	return enet_socket_send_at(socket, address, buffers, bufferCount, 0);
+}
+
+/* Send time is a CLOCK_MONOTONIC departure for SO_TXTIME in nanoseconds, 0 sends now */
+inline int enet_socket_send_at(ENetSocket socket, const ENetAddress* address, const ENetBuffer* buffers, size_t bufferCount, uint64_t sendTime) {
 	struct msghdr msgHdr;
 	struct sockaddr_in6 sin;
 	int sentLength;
+#ifdef SO_TXTIME
+	union {
+		struct cmsghdr header;
+		uint8_t data[CMSG_SPACE(sizeof(uint64_t))];
+	} control;
+#endif
 
 	memset(&msgHdr, 0, sizeof(struct msghdr));
 
@@ -4571,6 +6060,24 @@ inline int enet_socket_send(ENetSocket socket, const ENetAddress* address, const
 
 	msgHdr.msg_iov = (struct iovec*)buffers;
 	msgHdr.msg_iovlen = bufferCount;
+
+#ifdef SO_TXTIME
+	if(sendTime != 0) {
+		struct cmsghdr* cmsg;
+
+		memset(&control, 0, sizeof(control));
+		msgHdr.msg_control = control.data;
+		msgHdr.msg_controllen = sizeof(control.data);
+		cmsg = CMSG_FIRSTHDR(&msgHdr);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_TXTIME;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+		memcpy(CMSG_DATA(cmsg), &sendTime, sizeof(uint64_t));
+	}
+#else
+	(void)sendTime;
+#endif
+
 	sentLength = sendmsg(socket, &msgHdr, MSG_NOSIGNAL);
 
 	if(sentLength == -1) {
@@ -4617,6 +6124,146 @@ inline int enet_socket_receive(ENetSocket socket, ENetAddress* address, ENetBuff
 	return recvLength;
 }
 
+#ifdef ENET_USE_MMSG
+inline int enet_socket_receive_batch(ENetSocket socket, ENetDatagram* datagrams, size_t datagramCount, size_t dataLength) {
+	struct mmsghdr msgHdr[ENET_HOST_RECEIVE_BATCH_MAX];
+	struct iovec msgIov[ENET_HOST_RECEIVE_BATCH_MAX];
+	struct sockaddr_in6 sin[ENET_HOST_RECEIVE_BATCH_MAX];
+	int recvCount, i;
+
+	if(datagramCount > ENET_HOST_RECEIVE_BATCH_MAX)
+		datagramCount = ENET_HOST_RECEIVE_BATCH_MAX;
+
+	memset(msgHdr, 0, datagramCount * sizeof(struct mmsghdr));
+
+	for(i = 0; i < (int)datagramCount; ++i) {
+		msgIov[i].iov_base = datagrams[i].data;
+		msgIov[i].iov_len = dataLength;
+		msgHdr[i].msg_hdr.msg_name = &sin[i];
+		msgHdr[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+		msgHdr[i].msg_hdr.msg_iov = &msgIov[i];
+		msgHdr[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	recvCount = recvmmsg(socket, msgHdr, (unsigned int)datagramCount, MSG_NOSIGNAL, NULL);
+
+	if(recvCount == -1) {
+		if(errno == EWOULDBLOCK)
+			return 0;
+
+		return -1;
+	}
+
+	for(i = 0; i < recvCount; ++i) {
+		if((msgHdr[i].msg_hdr.msg_flags & MSG_TRUNC) || msgHdr[i].msg_len == 0) {
+			datagrams[i].dataLength = -2;
+
+			continue;
+		}
+
+		datagrams[i].dataLength = (int)msgHdr[i].msg_len;
+		datagrams[i].address.ipv6 = sin[i].sin6_addr;
+		datagrams[i].address.port = ENET_NET_TO_HOST_16(sin[i].sin6_port);
+	}
+
+	return recvCount;
+}
+
+inline int enet_socket_send_batch(ENetSocket socket, const ENetDatagram* datagrams, size_t datagramCount) {
+	struct mmsghdr msgHdr[ENET_HOST_SEND_BATCH_MAX];
+	struct iovec msgIov[ENET_HOST_SEND_BATCH_MAX];
+	struct sockaddr_in6 sin[ENET_HOST_SEND_BATCH_MAX];
+#ifdef SO_TXTIME
+	union {
+		struct cmsghdr header;
+		uint8_t data[CMSG_SPACE(sizeof(uint64_t))];
+	} control[ENET_HOST_SEND_BATCH_MAX];
+#endif
+	int sentCount, i;
+
+	if(datagramCount > ENET_HOST_SEND_BATCH_MAX)
+		datagramCount = ENET_HOST_SEND_BATCH_MAX;
+
+	memset(msgHdr, 0, datagramCount * sizeof(struct mmsghdr));
+	memset(sin, 0, datagramCount * sizeof(struct sockaddr_in6));
+
+	for(i = 0; i < (int)datagramCount; ++i) {
+		sin[i].sin6_family = AF_INET6;
+		sin[i].sin6_port = ENET_HOST_TO_NET_16(datagrams[i].address.port);
+		sin[i].sin6_addr = datagrams[i].address.ipv6;
+		msgIov[i].iov_base = (void*)datagrams[i].data;
+		msgIov[i].iov_len = datagrams[i].dataLength;
+		msgHdr[i].msg_hdr.msg_name = &sin[i];
+		msgHdr[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in6);
+		msgHdr[i].msg_hdr.msg_iov = &msgIov[i];
+		msgHdr[i].msg_hdr.msg_iovlen = 1;
+
+	#ifdef SO_TXTIME
+		if(datagrams[i].sendTime != 0) {
+			struct cmsghdr* cmsg;
+
+			memset(&control[i], 0, sizeof(control[i]));
+			msgHdr[i].msg_hdr.msg_control = control[i].data;
+			msgHdr[i].msg_hdr.msg_controllen = sizeof(control[i].data);
+			cmsg = CMSG_FIRSTHDR(&msgHdr[i].msg_hdr);
+			cmsg->cmsg_level = SOL_SOCKET;
+			cmsg->cmsg_type = SCM_TXTIME;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+			memcpy(CMSG_DATA(cmsg), &datagrams[i].sendTime, sizeof(uint64_t));
+		}
+	#endif
+	}
+
+	sentCount = sendmmsg(socket, msgHdr, (unsigned int)datagramCount, MSG_NOSIGNAL);
+
+	if(sentCount == -1) {
+		if(errno == EWOULDBLOCK)
+			return 0;
+
+		return -1;
+	}
+
+	return sentCount;
+}
+#else
+/* Without batch syscalls a single datagram is moved per call, so call counters stay exact */
+inline int enet_socket_receive_batch(ENetSocket socket, ENetDatagram* datagrams, size_t datagramCount, size_t dataLength) {
+	ENetBuffer buffer;
+
+	if(datagramCount == 0)
+		return 0;
+
+	buffer.data = datagrams->data;
+	buffer.dataLength = dataLength;
+	datagrams->dataLength = enet_socket_receive(socket, &datagrams->address, &buffer, 1);
+
+	if(datagrams->dataLength == 0)
+		return 0;
+
+	if(datagrams->dataLength == -1)
+		return -1;
+
+	return 1;
+}
+
+inline int enet_socket_send_batch(ENetSocket socket, const ENetDatagram* datagrams, size_t datagramCount) {
+	ENetBuffer buffer;
+	int sentLength;
+
+	if(datagramCount == 0)
+		return 0;
+
+	buffer.data = (void*)datagrams->data;
+	buffer.dataLength = datagrams->dataLength;
+	sentLength = enet_socket_send_at(socket, &datagrams->address, &buffer, 1, datagrams->sendTime);
+
+	if(sentLength < 0)
+		return -1;
+
+	return sentLength > 0 ? 1 : 0;
+}
+#endif
+
 inline int enet_socket_set_select(ENetSocket maxSocket, ENetSocketSet* readSet, ENetSocketSet* writeSet, uint32_t timeout) {
 	struct timeval timeVal;
 
@@ -4891,6 +6538,13 @@ inline int enet_socket_send(ENetSocket socket, const ENetAddress* address, const
 	return (int)sentLength;
 }
 
+/* No departure times for datagrams here, they are sent now */
+inline int enet_socket_send_at(ENetSocket socket, const ENetAddress* address, const ENetBuffer* buffers, size_t bufferCount, uint64_t sendTime) {
+	(void)sendTime;
+
+	return enet_socket_send(socket, address, buffers, bufferCount);
+}
+
 inline int enet_socket_receive(ENetSocket socket, ENetAddress* address, ENetBuffer* buffers, size_t bufferCount) {
 	INT sinLength = sizeof(struct sockaddr_in6);
 	DWORD flags = 0, recvLength = 0;
@@ -4917,6 +6571,43 @@ inline int enet_socket_receive(ENetSocket socket, ENetAddress* address, ENetBuff
 	return (int)recvLength;
 }
 
+/* Without batch syscalls a single datagram is moved per call, so call counters stay exact */
+inline int enet_socket_receive_batch(ENetSocket socket, ENetDatagram* datagrams, size_t datagramCount, size_t dataLength) {
+	ENetBuffer buffer;
+
+	if(datagramCount == 0)
+		return 0;
+
+	buffer.data = datagrams->data;
+	buffer.dataLength = dataLength;
+	datagrams->dataLength = enet_socket_receive(socket, &datagrams->address, &buffer, 1);
+
+	if(datagrams->dataLength == 0)
+		return 0;
+
+	if(datagrams->dataLength == -1)
+		return -1;
+
+	return 1;
+}
+
+inline int enet_socket_send_batch(ENetSocket socket, const ENetDatagram* datagrams, size_t datagramCount) {
+	ENetBuffer buffer;
+	int sentLength;
+
+	if(datagramCount == 0)
+		return 0;
+
+	buffer.data = (void*)datagrams->data;
+	buffer.dataLength = datagrams->dataLength;
+	sentLength = enet_socket_send_at(socket, &datagrams->address, &buffer, 1, datagrams->sendTime);
+
+	if(sentLength < 0)
+		return -1;
+
+	return sentLength > 0 ? 1 : 0;
+}
+
 inline int enet_socket_set_select(ENetSocket maxSocket, ENetSocketSet* readSet, ENetSocketSet* writeSet, uint32_t timeout) {
 	struct timeval timeVal;
 
@@ -5020,6 +6711,69 @@ inline uint32_t enet_host_get_bytes_received(const ENetHost* host) {
 	return host->totalReceivedData;
 }
 
+inline uint32_t enet_host_get_receive_calls(const ENetHost* host) {
+	return host->totalReceiveCalls;
+}
+
+inline uint32_t enet_host_get_send_calls(const ENetHost* host) {
+	return host->totalSendCalls;
+}
+
+inline uint32_t enet_host_get_replaced_commands(const ENetHost* host) {
+	return host->totalReplacedCommands;
+}
+
+inline uint32_t enet_host_get_cookie_replies(const ENetHost* host) {
+	return host->totalCookieReplies;
+}
+
+inline uint32_t enet_host_get_cookie_rejects(const ENetHost* host) {
+	return host->totalCookieRejects;
+}
+
+inline uint64_t enet_host_get_cookie_time(const ENetHost* host) {
+	return host->totalCookieTime;
+}
+
+inline uint32_t enet_host_get_limited_packets(const ENetHost* host) {
+	return host->totalLimitedPackets;
+}
+
+inline uint64_t enet_host_get_limited_bytes(const ENetHost* host) {
+	return host->totalLimitedData;
+}
+
+/* Histogram of time from queue to send, bucket n counts delays below 2^n microseconds, last bucket is open. NULL without channel schedule */
+inline const uint32_t* enet_host_get_queue_delay(const ENetHost* host, uint8_t channelID) {
+	if(host->queueDelay == NULL || channelID >= host->scheduleChannelCount)
+		return NULL;
+
+	return &host->queueDelay[channelID * ENET_HOST_QUEUE_DELAY_BUCKETS];
+}
+
+inline uint32_t enet_host_get_service_deadline(const ENetHost* host) {
+	if(!enet_list_empty(&host->dispatchQueue) || host->receiveBatchIndex < host->receiveBatchCount || host->sendBatchCount > 0)
+		return host->serviceTime;
+
+	return host->serviceDeadline;
+}
+
+inline size_t enet_host_get_pending_events(ENetHost* host) {
+	ENetListIterator currentPeer;
+	size_t count = 0;
+
+	for(currentPeer = enet_list_begin(&host->dispatchQueue); currentPeer != enet_list_end(&host->dispatchQueue); currentPeer = enet_list_next(currentPeer)) {
+		ENetPeer* peer = (ENetPeer*)currentPeer;
+
+		if(peer->state == ENET_PEER_STATE_CONNECTED)
+			count += enet_list_size(&peer->dispatchedCommands);
+		else
+			++count;
+	}
+
+	return count;
+}
+
 inline void enet_host_set_max_duplicate_peers(ENetHost* host, uint16_t number) {
 	if(number < 1)
 		number = 1;
@@ -5038,6 +6792,200 @@ inline void enet_host_set_checksum_callback(ENetHost* host, ENetChecksumCallback
 	host->checksumCallback = callback;
 }
 
+inline int enet_host_set_receive_batch(ENetHost* host, size_t count) {
+	ENetDatagram* batch = NULL;
+
+	if(host == NULL || host->receiveBatchIndex < host->receiveBatchCount)
+		return -1;
+
+	if(count > ENET_HOST_RECEIVE_BATCH_MAX)
+		count = ENET_HOST_RECEIVE_BATCH_MAX;
+
+	if(count > 1) {
+		batch = (ENetDatagram*)enet_malloc(count * sizeof(ENetDatagram));
+
+		if(batch == NULL)
+			return -1;
+	} else {
+		count = 0;
+	}
+
+	if(host->receiveBatch != NULL)
+		enet_free(host->receiveBatch);
+
+	host->receiveBatch = batch;
+	host->receiveBatchSize = count;
+	host->receiveBatchCount = 0;
+	host->receiveBatchIndex = 0;
+
+	return 0;
+}
+
+inline int enet_host_set_send_batch(ENetHost* host, size_t count) {
+	ENetDatagram* batch = NULL;
+
+	if(host == NULL || host->sendBatchCount > 0)
+		return -1;
+
+	if(count > ENET_HOST_SEND_BATCH_MAX)
+		count = ENET_HOST_SEND_BATCH_MAX;
+
+	if(count > 1) {
+		batch = (ENetDatagram*)enet_malloc(count * sizeof(ENetDatagram));
+
+		if(batch == NULL)
+			return -1;
+	} else {
+		count = 0;
+	}
+
+	if(host->sendBatch != NULL)
+		enet_free(host->sendBatch);
+
+	host->sendBatch = batch;
+	host->sendBatchSize = count;
+	host->sendBatchCount = 0;
+
+	return 0;
+}
+
+inline void enet_host_set_cookies(ENetHost* host, uint64_t key0, uint64_t key1) {
+	host->cookies = 1;
+	host->cookieKey[0] = key0;
+	host->cookieKey[1] = key1;
+}
+
+/* Datagrams per second and burst per source address, table size is rounded up to power of two, zero rate disables the limiter */
+inline int enet_host_set_rate_limit(ENetHost* host, uint32_t rate, uint32_t burst, size_t tableSize, uint64_t key0, uint64_t key1) {
+	ENetRateBucket* table = NULL;
+	size_t capacity = ENET_HOST_RATE_LIMIT_TABLE_MIN;
+
+	if(host == NULL)
+		return -1;
+
+	if(burst == 0)
+		burst = rate;
+
+	if(burst > UINT32_MAX / ENET_HOST_RATE_LIMIT_TOKEN)
+		burst = UINT32_MAX / ENET_HOST_RATE_LIMIT_TOKEN;
+
+	if(rate > 0) {
+		while(capacity < tableSize) {
+			capacity <<= 1;
+		}
+
+		table = (ENetRateBucket*)enet_malloc(capacity * sizeof(ENetRateBucket));
+
+		if(table == NULL)
+			return -1;
+
+		memset(table, 0, capacity * sizeof(ENetRateBucket));
+	}
+
+	if(host->rateTable != NULL)
+		enet_free(host->rateTable);
+
+	host->rateTable = table;
+	host->rateTableMask = table != NULL ? capacity - 1 : 0;
+	host->rateLimit = rate;
+	host->rateCapacity = burst * ENET_HOST_RATE_LIMIT_TOKEN;
+	host->rateRefillTime = rate > 0 ? host->rateCapacity / rate + 1 : 0;
+	host->rateKey[0] = key0;
+	host->rateKey[1] = key1;
+
+	return 0;
+}
+
+/* Priority and weight of the first channels, later channels keep FIFO order before scheduled ones. NULL or zero count restores FIFO order of all channels */
+inline int enet_host_set_channel_schedule(ENetHost* host, const ENetChannelSchedule* schedule, size_t count) {
+	ENetChannelSchedule* channelSchedule = NULL;
+	ENetList* scheduleQueues = NULL;
+	uint32_t* queueDelay = NULL;
+	size_t channelID;
+
+	if(host == NULL)
+		return -1;
+
+	if(count > ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT)
+		count = ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT;
+
+	if(schedule != NULL && count > 0) {
+		channelSchedule = (ENetChannelSchedule*)enet_malloc(count * sizeof(ENetChannelSchedule));
+		scheduleQueues = (ENetList*)enet_malloc(count * sizeof(ENetList));
+		queueDelay = (uint32_t*)enet_malloc(count * ENET_HOST_QUEUE_DELAY_BUCKETS * sizeof(uint32_t));
+
+		if(channelSchedule == NULL || scheduleQueues == NULL || queueDelay == NULL) {
+			if(channelSchedule != NULL)
+				enet_free(channelSchedule);
+
+			if(scheduleQueues != NULL)
+				enet_free(scheduleQueues);
+
+			if(queueDelay != NULL)
+				enet_free(queueDelay);
+
+			return -1;
+		}
+
+		for(channelID = 0; channelID < count; ++channelID) {
+			channelSchedule[channelID] = schedule[channelID];
+
+			if(channelSchedule[channelID].weight == 0)
+				channelSchedule[channelID].weight = 1;
+		}
+
+		memset(queueDelay, 0, count * ENET_HOST_QUEUE_DELAY_BUCKETS * sizeof(uint32_t));
+	} else {
+		count = 0;
+	}
+
+	if(host->channelSchedule != NULL)
+		enet_free(host->channelSchedule);
+
+	if(host->scheduleQueues != NULL)
+		enet_free(host->scheduleQueues);
+
+	if(host->queueDelay != NULL)
+		enet_free(host->queueDelay);
+
+	host->channelSchedule = channelSchedule;
+	host->scheduleQueues = scheduleQueues;
+	host->scheduleChannelCount = count;
+	host->queueDelay = queueDelay;
+
+	return 0;
+}
+
+/* Congestion control of all peers, peers should not be connected yet. NULL restores the packet throttle */
+inline void enet_host_set_congestion_control(ENetHost* host, const ENetCongestionControl* congestionControl) {
+	host->congestionControl = congestionControl != NULL ? congestionControl : enet_congestion_throttle();
+}
+
+/* Pacing of all peers on top of congestion control, SO_TXTIME fails where the socket has no support and pacing is left as it was */
+inline int enet_host_set_pacing(ENetHost* host, ENetPacing pacing) {
+	if(host == NULL)
+		return -1;
+
+	if(pacing == ENET_PACING_TXTIME && host->pacing != ENET_PACING_TXTIME && enet_socket_set_option(host->socket, ENET_SOCKOPT_TXTIME, 1) < 0)
+		return -1;
+
+	host->pacing = pacing;
+
+	return 0;
+}
+
+inline const ENetCongestionControl* enet_congestion_throttle(void) {
+	static const ENetCongestionControl congestionControl = {enet_peer_throttle_acknowledge, enet_peer_throttle_window, enet_peer_throttle_admit, NULL};
+
+	return &congestionControl;
+}
+
+inline const ENetCongestionControl* enet_congestion_delay(void) {
+	static const ENetCongestionControl congestionControl = {enet_peer_delay_acknowledge, enet_peer_delay_window, enet_peer_delay_admit, enet_peer_delay_rate};
+
+	return &congestionControl;
+}
+
 inline uint32_t enet_peer_get_id(const ENetPeer* peer) {
 	return peer->incomingPeerID;
 }
@@ -5086,6 +7034,10 @@ inline float enet_peer_get_packets_throttle(const ENetPeer* peer) {
 	return peer->packetThrottle / (float)ENET_PEER_PACKET_THROTTLE_SCALE * 100.0f;
 }
 
+inline uint32_t enet_peer_get_pacing_rate(const ENetPeer* peer) {
+	return peer->pacingRate;
+}
+
 inline uint64_t enet_peer_get_bytes_sent(const ENetPeer* peer) {
 	return peer->totalDataSent;
 }